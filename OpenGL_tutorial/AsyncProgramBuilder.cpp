@@ -0,0 +1,188 @@
+#include "AsyncProgramBuilder.h"
+#include "ProgramBinaryCache.h"
+
+#include <iostream>
+
+void AsyncProgramBuilder::Init(ProgramBinaryCache* binaryCache)
+{
+    cache = binaryCache;
+    parallelSupported = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+    parallel = parallelSupported;
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // let the driver pick
+    else if (GLAD_GL_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    else
+        std::cout << "Parallel shader compilation not supported, building shaders serially" << std::endl;
+}
+
+AsyncProgramHandle AsyncProgramBuilder::Submit(const ProgramSource& source, GLuint fallback)
+{
+    AsyncProgramHandle handle = std::make_shared<AsyncProgram>();
+    handle->name = source.name;
+    handle->fallback = fallback;
+
+    // a cached binary is cheap to restore and needs no compile at all
+    if (cache)
+    {
+        GLuint program = cache->Load(source);
+        if (program != 0)
+        {
+            handle->program = program;
+            handle->ready = true;
+            return handle;
+        }
+    }
+
+    PendingBuild build;
+    build.handle = handle;
+    build.source = source;
+    if (parallel)
+        Issue(build);
+    pending.push_back(std::move(build));
+    return handle;
+}
+
+void AsyncProgramBuilder::Issue(PendingBuild& build)
+{
+    const ProgramSource& source = build.source;
+    const std::pair<GLenum, const std::string*> stages[] = {
+        { GL_VERTEX_SHADER, &source.vertex },
+        { GL_FRAGMENT_SHADER, &source.fragment },
+        { GL_COMPUTE_SHADER, &source.compute },
+    };
+
+    // no status queries here: they would wait for the compile to finish
+    GLuint program = glCreateProgram();
+    if (cache)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (const auto& stage : stages)
+    {
+        if (stage.second->empty())
+            continue;
+        std::string code = InjectDefines(*stage.second, source.defines);
+        const char* text = code.c_str();
+        GLuint shader = glCreateShader(stage.first);
+        glShaderSource(shader, 1, &text, NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        build.shaders.push_back(shader);
+    }
+    glLinkProgram(program);
+    build.handle->program = program;
+    build.issued = true;
+}
+
+bool AsyncProgramBuilder::Complete(PendingBuild& build)
+{
+    AsyncProgram& result = *build.handle;
+
+    if (!build.issued)
+    {
+        result.program = BuildProgram(build.source, cache != nullptr);
+    }
+    else
+    {
+        GLint done = GL_FALSE;
+        glGetProgramiv(result.program, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+            return false;
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(result.program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            // report the stage that broke, or the link log if every stage compiled
+            bool compileError = false;
+            for (GLuint shader : build.shaders)
+            {
+                GLint compiled = GL_FALSE;
+                glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+                if (!compiled)
+                {
+                    GLint length = 0;
+                    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+                    std::string infoLog(length > 0 ? length : 1, '\0');
+                    glGetShaderInfoLog(shader, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+                    std::cout << "ERROR::SHADER_COMPILATION_ERROR in " << result.name << "\n" << infoLog << std::endl;
+                    compileError = true;
+                }
+            }
+            if (!compileError)
+            {
+                GLint length = 0;
+                glGetProgramiv(result.program, GL_INFO_LOG_LENGTH, &length);
+                std::string infoLog(length > 0 ? length : 1, '\0');
+                glGetProgramInfoLog(result.program, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR in " << result.name << "\n" << infoLog << std::endl;
+            }
+        }
+
+        for (GLuint shader : build.shaders)
+        {
+            glDetachShader(result.program, shader);
+            glDeleteShader(shader);
+        }
+        build.shaders.clear();
+
+        if (!linked)
+        {
+            glDeleteProgram(result.program);
+            result.program = 0;
+        }
+    }
+
+    if (result.program == 0)
+        result.failed = true;
+    else
+    {
+        if (cache)
+            cache->Store(build.source, result.program);
+        result.ready = true;
+    }
+    return true;
+}
+
+unsigned int AsyncProgramBuilder::Poll(unsigned int serialBudget)
+{
+    unsigned int finished = 0;
+    for (size_t i = 0; i < pending.size();)
+    {
+        if (!parallel && finished >= serialBudget)
+            break;
+        if (Complete(pending[i]))
+        {
+            pending.erase(pending.begin() + i);
+            finished++;
+        }
+        else
+            ++i;
+    }
+    return finished;
+}
+
+bool AsyncProgramBuilder::Wait(const AsyncProgramHandle& handle)
+{
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        if (pending[i].handle != handle)
+            continue;
+        // the link status query blocks until the driver's compiler threads are done with it
+        if (pending[i].issued)
+        {
+            GLint linked = GL_FALSE;
+            glGetProgramiv(handle->program, GL_LINK_STATUS, &linked);
+        }
+        while (!Complete(pending[i]))
+            ;
+        pending.erase(pending.begin() + i);
+        break;
+    }
+    return handle->ready;
+}
+
+void AsyncProgramBuilder::Finish()
+{
+    while (!pending.empty())
+        Poll((unsigned int)pending.size());
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <memory>
+#include <vector>
+
+class ProgramBinaryCache;
+
+// A program that may still be compiling. Draw with Current(): it returns the fallback
+// program until the real one has linked.
+struct AsyncProgram
+{
+    std::string name;
+    GLuint program = 0;
+    GLuint fallback = 0;
+    bool ready = false;
+    bool failed = false;
+
+    GLuint Current() const { return ready ? program : fallback; }
+};
+
+typedef std::shared_ptr<AsyncProgram> AsyncProgramHandle;
+
+// Builds programs without blocking the render loop.
+// With KHR_parallel_shader_compile every compile and link is issued up front at Submit and
+// Poll only checks GL_COMPLETION_STATUS_KHR, so the driver compiles on its own threads.
+// Without the extension Poll finishes the programs one by one (serial compilation), at most
+// `serialBudget` per call, so the stall per frame stays bounded.
+class AsyncProgramBuilder
+{
+public:
+    // Needs a current context; raises the driver's compiler thread count when supported.
+    void Init(ProgramBinaryCache* cache = nullptr);
+    bool Parallel() const { return parallel; }
+    // Builds serially even when the extension is available (for comparison runs); affects
+    // programs submitted afterwards.
+    void SetParallel(bool enable) { parallel = enable && parallelSupported; }
+
+    AsyncProgramHandle Submit(const ProgramSource& source, GLuint fallback = 0);
+    // Non-blocking with the extension; call once per frame. Returns the number of programs
+    // that finished during this call.
+    unsigned int Poll(unsigned int serialBudget = 1);
+    // Blocks until every submitted program is done.
+    void Finish();
+    // Blocks until this one program is done; returns whether it is ready.
+    bool Wait(const AsyncProgramHandle& handle);
+
+    size_t Pending() const { return pending.size(); }
+
+private:
+    struct PendingBuild
+    {
+        AsyncProgramHandle handle;
+        ProgramSource source;
+        std::vector<GLuint> shaders;
+        bool issued = false; // compiles handed to the driver at Submit
+    };
+
+    void Issue(PendingBuild& build);
+    bool Complete(PendingBuild& build);
+
+    ProgramBinaryCache* cache = nullptr;
+    bool parallelSupported = false;
+    bool parallel = false;
+    std::vector<PendingBuild> pending;
+};
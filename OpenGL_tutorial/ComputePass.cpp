@@ -0,0 +1,212 @@
+#include "ComputePass.h"
+
+#include "GLStateCache.h"
+
+namespace
+{
+    // storage buffers, images and atomic counters are accessed incoherently by shaders
+    bool IsIncoherent(ResourceUsage usage)
+    {
+        return usage == ResourceUsage::StorageBuffer || usage == ResourceUsage::Image || usage == ResourceUsage::AtomicCounter;
+    }
+
+    bool IsShaderWrite(const ResourceUse& resource)
+    {
+        return resource.access != ResourceAccess::Read && IsIncoherent(resource.usage);
+    }
+
+    bool IsShaderRead(const ResourceUse& resource)
+    {
+        return resource.access != ResourceAccess::Write && IsIncoherent(resource.usage);
+    }
+
+    // every bit BarrierBit can return
+    const GLbitfield ALL_USAGE_BITS = GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT
+        | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_COMMAND_BARRIER_BIT
+        | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT
+        | GL_FRAMEBUFFER_BARRIER_BIT;
+
+    int BitIndex(GLbitfield bit)
+    {
+        int index = 0;
+        while ((bit >>= 1) != 0)
+            ++index;
+        return index;
+    }
+
+    // buffers and textures have separate name spaces
+    uint64_t ResourceKey(GLuint object, ResourceUsage usage)
+    {
+        bool texture = usage == ResourceUsage::Image || usage == ResourceUsage::Texture || usage == ResourceUsage::Framebuffer;
+        return ((uint64_t)texture << 32) | object;
+    }
+
+    GLenum ImageAccess(ResourceAccess access)
+    {
+        switch (access)
+        {
+        case ResourceAccess::Read:  return GL_READ_ONLY;
+        case ResourceAccess::Write: return GL_WRITE_ONLY;
+        default:                    return GL_READ_WRITE;
+        }
+    }
+}
+
+GLbitfield ComputeScheduler::BarrierBit(ResourceUsage usage)
+{
+    switch (usage)
+    {
+    case ResourceUsage::StorageBuffer: return GL_SHADER_STORAGE_BARRIER_BIT;
+    case ResourceUsage::UniformBuffer: return GL_UNIFORM_BARRIER_BIT;
+    case ResourceUsage::AtomicCounter: return GL_ATOMIC_COUNTER_BARRIER_BIT;
+    case ResourceUsage::Image:         return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    case ResourceUsage::Texture:       return GL_TEXTURE_FETCH_BARRIER_BIT;
+    case ResourceUsage::Indirect:      return GL_COMMAND_BARRIER_BIT;
+    case ResourceUsage::VertexBuffer:  return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+    case ResourceUsage::IndexBuffer:   return GL_ELEMENT_ARRAY_BARRIER_BIT;
+    case ResourceUsage::BufferUpdate:  return GL_BUFFER_UPDATE_BARRIER_BIT;
+    case ResourceUsage::Framebuffer:   return GL_FRAMEBUFFER_BARRIER_BIT;
+    }
+    return 0;
+}
+
+bool ComputeScheduler::Covered(uint64_t dispatch, GLbitfield bit) const
+{
+    return dispatch <= barrierSequence[BitIndex(bit)];
+}
+
+GLbitfield ComputeScheduler::RequiredBits(GLuint object, ResourceUsage usage) const
+{
+    auto hazard = hazards.find(ResourceKey(object, usage));
+    if (hazard == hazards.end())
+        return 0;
+    GLbitfield bit = BarrierBit(usage);
+    return Covered(hazard->second.write, bit) ? 0 : bit;
+}
+
+GLbitfield ComputeScheduler::Uncovered(uint64_t dispatch, GLbitfield bits) const
+{
+    GLbitfield uncovered = 0;
+    for (GLbitfield remaining = bits; remaining != 0; remaining &= remaining - 1)
+    {
+        GLbitfield bit = remaining & (~remaining + 1);
+        if (!Covered(dispatch, bit))
+            uncovered |= bit;
+    }
+    return uncovered;
+}
+
+GLbitfield ComputeScheduler::WriteAfterReadBits(const ResourceUse& resource) const
+{
+    if (!IsShaderWrite(resource))
+        return 0;
+    auto hazard = hazards.find(ResourceKey(resource.object, resource.usage));
+    if (hazard == hazards.end())
+        return 0;
+    return Uncovered(hazard->second.read, hazard->second.readBits);
+}
+
+void ComputeScheduler::Barrier(GLbitfield bits)
+{
+    if (bits == 0)
+        return;
+    glMemoryBarrier(bits);
+    barriers++;
+    // a barrier covers every access issued before it, whichever pass made it
+    for (GLbitfield remaining = bits; remaining != 0; remaining &= remaining - 1)
+        barrierSequence[BitIndex(remaining & (~remaining + 1))] = sequence;
+}
+
+void ComputeScheduler::Bind(const ResourceUse& resource)
+{
+    switch (resource.usage)
+    {
+    case ResourceUsage::StorageBuffer:
+        GLState().BindBufferBase(GL_SHADER_STORAGE_BUFFER, resource.binding, resource.object);
+        break;
+    case ResourceUsage::UniformBuffer:
+        GLState().BindBufferBase(GL_UNIFORM_BUFFER, resource.binding, resource.object);
+        break;
+    case ResourceUsage::AtomicCounter:
+        GLState().BindBufferBase(GL_ATOMIC_COUNTER_BUFFER, resource.binding, resource.object);
+        break;
+    case ResourceUsage::Image:
+        glBindImageTexture(resource.binding, resource.object, 0, GL_TRUE, 0, ImageAccess(resource.access), resource.format);
+        break;
+    case ResourceUsage::Texture:
+        GLState().BindTextureUnit(resource.binding, resource.object);
+        break;
+    default:
+        break; // consumed through other entry points (indirect, vertex fetch, copies)
+    }
+}
+
+void ComputeScheduler::Dispatch(const ComputePass& pass)
+{
+    GLbitfield bits = 0;
+    for (const ResourceUse& resource : pass.resources)
+    {
+        // read-after-write and write-after-write both need the writes to be visible
+        bits |= RequiredBits(resource.object, resource.usage);
+        bits |= WriteAfterReadBits(resource);
+    }
+    if (pass.indirectBuffer != 0)
+        bits |= RequiredBits(pass.indirectBuffer, ResourceUsage::Indirect);
+    Barrier(bits);
+
+    GLState().UseProgram(pass.program);
+    for (const ResourceUse& resource : pass.resources)
+        Bind(resource);
+
+    if (pass.indirectBuffer != 0)
+    {
+        GLState().BindBuffer(GL_DISPATCH_INDIRECT_BUFFER, pass.indirectBuffer);
+        glDispatchComputeIndirect(pass.indirectOffset);
+    }
+    else
+        glDispatchCompute(pass.groups[0], pass.groups[1], pass.groups[2]);
+    dispatches++;
+    sequence++;
+
+    for (const ResourceUse& resource : pass.resources)
+    {
+        if (IsShaderWrite(resource))
+            hazards[ResourceKey(resource.object, resource.usage)].write = sequence;
+        if (IsShaderRead(resource))
+        {
+            Hazard& hazard = hazards[ResourceKey(resource.object, resource.usage)];
+            // bits already covered for the previous read would only cost a needless barrier
+            hazard.readBits = Uncovered(hazard.read, hazard.readBits) | BarrierBit(resource.usage);
+            hazard.read = sequence;
+        }
+    }
+}
+
+void ComputeScheduler::Consume(GLuint object, ResourceUsage usage)
+{
+    Barrier(RequiredBits(object, usage));
+}
+
+void ComputeScheduler::Consume(const std::vector<ResourceUse>& resources)
+{
+    GLbitfield bits = 0;
+    for (const ResourceUse& resource : resources)
+        bits |= RequiredBits(resource.object, resource.usage);
+    Barrier(bits);
+}
+
+void ComputeScheduler::BeginFrame()
+{
+    barriersLastFrame = barriers;
+    dispatchesLastFrame = dispatches;
+    barriers = 0;
+    dispatches = 0;
+
+    for (auto it = hazards.begin(); it != hazards.end();)
+    {
+        if (Uncovered(it->second.write, ALL_USAGE_BITS) == 0 && Uncovered(it->second.read, it->second.readBits) == 0)
+            it = hazards.erase(it);
+        else
+            ++it;
+    }
+}
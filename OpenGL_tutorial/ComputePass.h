@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How a pass (or a draw) touches a resource. Each usage maps to the glMemoryBarrier bit that
+// makes earlier shader writes visible to it.
+enum class ResourceUsage
+{
+    StorageBuffer,  // SSBO, GL_SHADER_STORAGE_BARRIER_BIT
+    UniformBuffer,  // UBO, GL_UNIFORM_BARRIER_BIT
+    AtomicCounter,  // GL_ATOMIC_COUNTER_BARRIER_BIT
+    Image,          // image load/store, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+    Texture,        // sampled texture, GL_TEXTURE_FETCH_BARRIER_BIT
+    Indirect,       // draw/dispatch arguments, GL_COMMAND_BARRIER_BIT
+    VertexBuffer,   // GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+    IndexBuffer,    // GL_ELEMENT_ARRAY_BARRIER_BIT
+    BufferUpdate,   // glBufferSubData / glGetBufferSubData / copies, GL_BUFFER_UPDATE_BARRIER_BIT
+    Framebuffer,    // render target attachment, GL_FRAMEBUFFER_BARRIER_BIT
+};
+
+enum class ResourceAccess
+{
+    Read,
+    Write,
+    ReadWrite,
+};
+
+struct ResourceUse
+{
+    GLuint object;
+    ResourceUsage usage;
+    ResourceAccess access;
+    GLuint binding = 0;        // binding point / texture or image unit
+    GLenum format = GL_RGBA8;  // images only
+};
+
+struct ComputePass
+{
+    std::string name;
+    GLuint program = 0;
+    std::vector<ResourceUse> resources;
+    GLuint groups[3] = { 1, 1, 1 };
+    // when set, the group counts are read from this buffer at `indirectOffset`
+    GLuint indirectBuffer = 0;
+    GLintptr indirectOffset = 0;
+};
+
+// Runs compute passes and inserts the minimal glMemoryBarrier between dependent work.
+// Every pass declares the resources it reads and writes. A shader write (storage buffer,
+// image, atomic counter) leaves the resource "dirty"; a later pass or draw that consumes it
+// gets exactly the barrier bit for its kind of access, and only if no earlier barrier already
+// covered that bit.
+// Write-after-read: GL keeps a later command's writes from overtaking an earlier command's
+// ordinary reads, but shader storage, image and atomic reads are incoherent and only ordered by
+// glMemoryBarrier, so a pass writing what an earlier pass read that way gets the bit of that read
+// unless a barrier with it was issued in between.
+// Hazards are kept as dispatch sequence numbers against the sequence of the last barrier per
+// bit, so a barrier costs the same however many objects are tracked. An object leaves the table
+// in BeginFrame once every barrier it could still need has been issued.
+// Draws that consume compute output declare it with Consume() before the draw call.
+class ComputeScheduler
+{
+public:
+    void Dispatch(const ComputePass& pass);
+    // Makes earlier compute writes visible to a non-compute consumer.
+    void Consume(GLuint object, ResourceUsage usage);
+    void Consume(const std::vector<ResourceUse>& resources);
+
+    // Rolls the per-frame statistics and prunes objects with no hazard left.
+    void BeginFrame();
+    unsigned int BarriersLastFrame() const { return barriersLastFrame; }
+    unsigned int DispatchesLastFrame() const { return dispatchesLastFrame; }
+    size_t TrackedObjects() const { return hazards.size(); }
+
+    static GLbitfield BarrierBit(ResourceUsage usage);
+
+private:
+    struct Hazard
+    {
+        uint64_t write = 0; // sequence of the last dispatch writing the object from a shader
+        uint64_t read = 0;  // sequence of the last dispatch reading it incoherently
+        GLbitfield readBits = 0; // barrier bits of those reads
+    };
+
+    // barrier bits among `bits` not issued since dispatch `dispatch`
+    GLbitfield Uncovered(uint64_t dispatch, GLbitfield bits) const;
+
+    // whether a barrier with `bit` was issued after dispatch `dispatch`
+    bool Covered(uint64_t dispatch, GLbitfield bit) const;
+    GLbitfield RequiredBits(GLuint object, ResourceUsage usage) const;
+    GLbitfield WriteAfterReadBits(const ResourceUse& resource) const;
+    void Barrier(GLbitfield bits);
+    void Bind(const ResourceUse& resource);
+
+    std::unordered_map<uint64_t, Hazard> hazards;
+    uint64_t sequence = 0;            // dispatches issued so far
+    uint64_t barrierSequence[32] = {}; // per barrier bit: `sequence` when it was last issued
+    unsigned int barriers = 0;
+    unsigned int dispatches = 0;
+    unsigned int barriersLastFrame = 0;
+    unsigned int dispatchesLastFrame = 0;
+};
@@ -0,0 +1,70 @@
+#include "ContextConfig.h"
+#include "DebugOutput.h"
+
+#include <cstring>
+#include <iostream>
+
+ContextMode DefaultContextMode()
+{
+#ifdef NDEBUG
+    return ContextMode::NoError;
+#else
+    return ContextMode::Validating;
+#endif
+}
+
+ContextMode ParseContextMode(int argc, char** argv)
+{
+    ContextMode mode = DefaultContextMode();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--no-error") == 0)
+            mode = ContextMode::NoError;
+        else if (strcmp(argv[i], "--debug-context") == 0)
+            mode = ContextMode::Validating;
+    }
+    return mode;
+}
+
+const char* ContextModeName(ContextMode mode)
+{
+    return mode == ContextMode::NoError ? "no-error" : "validating";
+}
+
+void ApplyContextHints(ContextMode mode)
+{
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // a no-error context can't also be a debug context
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, mode == ContextMode::Validating ? GLFW_TRUE : GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_NO_ERROR, mode == ContextMode::NoError ? GLFW_TRUE : GLFW_FALSE);
+}
+
+ContextMode ConfigureContext(GLFWwindow* window, ContextMode mode)
+{
+    if (mode == ContextMode::NoError)
+    {
+        // GLFW silently ignores the hint when the platform can't create no-error contexts
+        if (glfwGetWindowAttrib(window, GLFW_CONTEXT_NO_ERROR) && GLAD_GL_KHR_no_error)
+            return ContextMode::NoError;
+
+        // errors are checked anyway, so they might as well be reported
+        std::cout << "KHR_no_error not available, running with error checking" << std::endl;
+        DebugOutput::Install();
+        return ContextMode::Validating;
+    }
+
+    if (!glfwGetWindowAttrib(window, GLFW_OPENGL_DEBUG_CONTEXT))
+        std::cout << "Debug context not granted, debug output may be incomplete" << std::endl;
+    DebugOutput::Install();
+    return ContextMode::Validating;
+}
+
+bool CurrentContextIsNoError()
+{
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    return (flags & GL_CONTEXT_FLAG_NO_ERROR_BIT) != 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// How the GL context is created.
+//   Validating: debug context with the KHR_debug callback installed when
+//               GL_DEBUG_OUTPUT_ENABLED is set (development).
+//   NoError:    KHR_no_error context, the driver skips error checking on every call (release).
+// The default follows the build type and can be overridden on the command line with
+// --debug-context or --no-error.
+enum class ContextMode
+{
+    Validating,
+    NoError
+};
+
+ContextMode DefaultContextMode();
+ContextMode ParseContextMode(int argc, char** argv);
+const char* ContextModeName(ContextMode mode);
+
+// Window hints for the requested mode; call before glfwCreateWindow.
+void ApplyContextHints(ContextMode mode);
+// Per-context setup once GLAD is loaded; returns the mode the driver actually granted.
+ContextMode ConfigureContext(GLFWwindow* window, ContextMode mode);
+// Whether the current context is a KHR_no_error context, where glGetError can't be relied on.
+bool CurrentContextIsNoError();
@@ -0,0 +1,302 @@
+#include "DebugOutput.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    const size_t RING_SIZE = 1024; // must be a power of two
+    const size_t MAX_MESSAGE_LENGTH = 256;
+
+    struct RawMessage
+    {
+        GLenum source;
+        GLenum type;
+        GLenum severity;
+        GLuint id;
+        GLsizei length;
+        char text[MAX_MESSAGE_LENGTH];
+    };
+
+    // bounded multi-producer ring (the driver may call back from several threads)
+    // ---------------------------------------------------------------------------
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        RawMessage message;
+    };
+
+    Slot ring[RING_SIZE];
+    std::atomic<size_t> enqueuePos(0);
+    std::atomic<size_t> dequeuePos(0);
+
+    bool Push(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* text)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;)
+        {
+            slot = &ring[pos & (RING_SIZE - 1)];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; // full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+
+        if (length < 0)
+            length = (GLsizei)strlen(text);
+        length = std::min<GLsizei>(length, MAX_MESSAGE_LENGTH - 1);
+
+        slot->message.source = source;
+        slot->message.type = type;
+        slot->message.severity = severity;
+        slot->message.id = id;
+        slot->message.length = length;
+        memcpy(slot->message.text, text, length);
+        slot->message.text[length] = '\0';
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // only the aggregator thread pops
+    bool Pop(RawMessage& out)
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Slot& slot = ring[pos & (RING_SIZE - 1)];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0)
+            return false;
+        out = slot.message;
+        slot.sequence.store(pos + RING_SIZE, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // aggregation
+    // -----------
+    struct MessageKey
+    {
+        GLenum source, type, severity;
+        GLuint id;
+        bool operator==(const MessageKey& o) const
+        {
+            return source == o.source && type == o.type && severity == o.severity && id == o.id;
+        }
+    };
+
+    struct MessageKeyHash
+    {
+        size_t operator()(const MessageKey& k) const
+        {
+            uint64_t h = ((uint64_t)k.source << 48) ^ ((uint64_t)k.type << 32) ^ ((uint64_t)k.severity << 16) ^ k.id;
+            return std::hash<uint64_t>()(h);
+        }
+    };
+
+    std::mutex statsMutex;
+    std::unordered_map<MessageKey, DebugOutput::MessageStats, MessageKeyHash> stats;
+
+    std::atomic<bool> running(false);
+    std::atomic<uint64_t> dropped(0);
+    std::atomic<size_t> consumed(0);
+    std::atomic<unsigned int> perfThisFrame(0);
+    std::atomic<unsigned int> perfLastFrame(0);
+    std::thread aggregator;
+
+    const char* SourceName(GLenum source)
+    {
+        switch (source)
+        {
+        case GL_DEBUG_SOURCE_API:             return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "Window System";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY:     return "Third Party";
+        case GL_DEBUG_SOURCE_APPLICATION:     return "Application";
+        default:                              return "Other";
+        }
+    }
+
+    const char* TypeName(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_DEBUG_TYPE_ERROR:               return "Error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behaviour";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "Undefined Behaviour";
+        case GL_DEBUG_TYPE_PORTABILITY:         return "Portability";
+        case GL_DEBUG_TYPE_PERFORMANCE:         return "Performance";
+        case GL_DEBUG_TYPE_MARKER:              return "Marker";
+        default:                                return "Other";
+        }
+    }
+
+    void Consume(const RawMessage& message)
+    {
+        if (message.type == GL_DEBUG_TYPE_PERFORMANCE)
+            perfThisFrame.fetch_add(1, std::memory_order_relaxed);
+
+        MessageKey key = { message.source, message.type, message.severity, message.id };
+        bool first = false;
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            auto it = stats.find(key);
+            if (it == stats.end())
+            {
+                DebugOutput::MessageStats entry = { message.source, message.type, message.severity, message.id, 1, message.text };
+                stats.emplace(key, entry);
+                first = true;
+            }
+            else
+                it->second.count++;
+        }
+
+        // only the first occurrence of a message is reported, repeats are just counted
+        if (first && message.severity != GL_DEBUG_SEVERITY_NOTIFICATION)
+        {
+            std::cout << "GL debug (" << SourceName(message.source) << ", " << TypeName(message.type)
+                << ", id " << message.id << "): " << message.text << std::endl;
+        }
+    }
+
+    void AggregatorLoop()
+    {
+        RawMessage message;
+        while (running.load(std::memory_order_acquire))
+        {
+            bool any = false;
+            while (Pop(message))
+            {
+                Consume(message);
+                consumed.fetch_add(1, std::memory_order_release);
+                any = true;
+            }
+            if (!any)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        while (Pop(message))
+        {
+            Consume(message);
+            consumed.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void APIENTRY DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar* message, const void* /*userParam*/)
+    {
+        if (!Push(source, type, id, severity, length, message))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void ResetRing()
+    {
+        for (size_t i = 0; i < RING_SIZE; ++i)
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+        consumed.store(0, std::memory_order_relaxed);
+    }
+}
+
+namespace DebugOutput
+{
+    bool Install()
+    {
+#if GL_DEBUG_OUTPUT_ENABLED
+        if (!GLAD_GL_KHR_debug && !GLAD_GL_VERSION_4_3)
+        {
+            std::cout << "KHR_debug not supported, debug output disabled" << std::endl;
+            return false;
+        }
+        // the aggregator is shared, the callback has to be installed on every context
+        if (!running.load())
+        {
+            ResetRing();
+            running.store(true, std::memory_order_release);
+            aggregator = std::thread(AggregatorLoop);
+        }
+
+        // asynchronous output: the callback may run on driver threads, which the ring tolerates
+        glEnable(GL_DEBUG_OUTPUT);
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(DebugCallback, nullptr);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Uninstall()
+    {
+#if GL_DEBUG_OUTPUT_ENABLED
+        if (!GLAD_GL_KHR_debug && !GLAD_GL_VERSION_4_3)
+            return;
+        glDebugMessageCallback(nullptr, nullptr);
+        glDisable(GL_DEBUG_OUTPUT);
+#endif
+    }
+
+    void Shutdown()
+    {
+        if (!running.load())
+            return;
+        running.store(false, std::memory_order_release);
+        aggregator.join();
+    }
+
+    bool Drain(unsigned int timeoutMs)
+    {
+        if (!running.load())
+            return false;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (consumed.load(std::memory_order_acquire) < enqueuePos.load(std::memory_order_relaxed))
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    void BeginFrame()
+    {
+        perfLastFrame.store(perfThisFrame.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    unsigned int PerformanceMessagesLastFrame()
+    {
+        return perfLastFrame.load(std::memory_order_relaxed);
+    }
+
+    uint64_t DroppedMessages()
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    std::vector<MessageStats> Snapshot()
+    {
+        std::vector<MessageStats> result;
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            result.reserve(stats.size());
+            for (const auto& entry : stats)
+                result.push_back(entry.second);
+        }
+        std::sort(result.begin(), result.end(),
+            [](const MessageStats& a, const MessageStats& b) { return a.count > b.count; });
+        return result;
+    }
+}
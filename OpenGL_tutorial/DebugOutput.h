@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// KHR_debug output is compiled out of release builds unless explicitly requested.
+// Define GL_DEBUG_OUTPUT_ENABLED to 0 or 1 to override the default.
+#ifndef GL_DEBUG_OUTPUT_ENABLED
+#ifdef NDEBUG
+#define GL_DEBUG_OUTPUT_ENABLED 0
+#else
+#define GL_DEBUG_OUTPUT_ENABLED 1
+#endif
+#endif
+
+// Asynchronous KHR_debug message pipeline.
+// The driver callback only copies the raw message into a lock-free ring; a background
+// thread drains the ring, deduplicates messages by (source, type, severity, id) and keeps
+// per-frame counters of GL_DEBUG_TYPE_PERFORMANCE messages.
+namespace DebugOutput
+{
+    struct MessageStats
+    {
+        GLenum source;
+        GLenum type;
+        GLenum severity;
+        GLuint id;
+        uint64_t count;
+        std::string text; // text of the first occurrence
+    };
+
+    // Installs the callback on the current context; call once per context. Returns false if
+    // the subsystem is compiled out or the context does not expose KHR_debug.
+    bool Install();
+    // Removes the callback from the current context; call on every context Install ran on
+    // before it is destroyed (WindowManager does this for its windows).
+    void Uninstall();
+    // Drains pending messages and joins the aggregator thread, once every context is uninstalled.
+    void Shutdown();
+    // Waits until every message queued so far has been aggregated; false on timeout.
+    bool Drain(unsigned int timeoutMs);
+
+    // Closes the current frame's counters; call once per frame.
+    void BeginFrame();
+    unsigned int PerformanceMessagesLastFrame();
+    uint64_t DroppedMessages();
+
+    // Copy of every distinct message seen so far, most frequent first.
+    std::vector<MessageStats> Snapshot();
+}
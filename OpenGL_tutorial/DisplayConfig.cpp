@@ -0,0 +1,160 @@
+#include "DisplayConfig.h"
+
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void ComputeRenderSize(const RenderScaleSettings& settings, DisplayState& state)
+{
+    double width = state.framebufferWidth;
+    double height = state.framebufferHeight;
+
+    switch (settings.policy)
+    {
+    case RenderScalePolicy::Native:
+        break;
+    case RenderScalePolicy::FixedScale:
+        width = width / std::max(state.contentScaleX, 0.01f) * settings.scale;
+        height = height / std::max(state.contentScaleY, 0.01f) * settings.scale;
+        break;
+    case RenderScalePolicy::CappedPixels:
+    {
+        double pixels = width * height;
+        if (pixels > (double)settings.maxPixels)
+        {
+            double factor = std::sqrt((double)settings.maxPixels / pixels);
+            width *= factor;
+            height *= factor;
+        }
+        break;
+    }
+    }
+
+    // never render above native, the extra pixels would be thrown away by the downscale
+    state.renderWidth = std::max(1, std::min(state.framebufferWidth, (int)std::lround(width)));
+    state.renderHeight = std::max(1, std::min(state.framebufferHeight, (int)std::lround(height)));
+}
+
+void DisplayConfig::ApplyWindowHints()
+{
+    // window sizes are given in logical units and resized when moved to a monitor with another scale
+    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
+}
+
+void DisplayConfig::SetSettings(const RenderScaleSettings& newSettings)
+{
+    settings = newSettings;
+    for (auto& window : windows)
+        Recompute(window.second);
+}
+
+void DisplayConfig::Track(GLFWwindow* window)
+{
+    Entry& entry = windows[window];
+    glfwGetFramebufferSize(window, &entry.state.framebufferWidth, &entry.state.framebufferHeight);
+    glfwGetWindowContentScale(window, &entry.state.contentScaleX, &entry.state.contentScaleY);
+    Recompute(entry);
+}
+
+void DisplayConfig::Untrack(GLFWwindow* window)
+{
+    auto it = windows.find(window);
+    if (it == windows.end())
+        return;
+    ReleaseTarget(it->second);
+    windows.erase(it);
+}
+
+void DisplayConfig::OnFramebufferSize(GLFWwindow* window, int width, int height)
+{
+    Entry& entry = windows[window];
+    entry.state.framebufferWidth = width;
+    entry.state.framebufferHeight = height;
+    Recompute(entry);
+}
+
+void DisplayConfig::OnContentScale(GLFWwindow* window, float xscale, float yscale)
+{
+    Entry& entry = windows[window];
+    entry.state.contentScaleX = xscale;
+    entry.state.contentScaleY = yscale;
+    Recompute(entry);
+}
+
+void DisplayConfig::Recompute(Entry& entry)
+{
+    ComputeRenderSize(settings, entry.state);
+}
+
+void DisplayConfig::ReleaseTarget(Entry& entry)
+{
+    if (entry.framebuffer == 0)
+        return;
+    GLState().ForgetFramebuffer(entry.framebuffer);
+    glDeleteFramebuffers(1, &entry.framebuffer);
+    glDeleteRenderbuffers(1, &entry.colorBuffer);
+    glDeleteRenderbuffers(1, &entry.depthBuffer);
+    entry.framebuffer = 0;
+    entry.colorBuffer = 0;
+    entry.depthBuffer = 0;
+    entry.targetWidth = 0;
+    entry.targetHeight = 0;
+}
+
+void DisplayConfig::BeginScene(GLFWwindow* window)
+{
+    Entry& entry = windows[window];
+    const DisplayState& state = entry.state;
+
+    bool native = state.renderWidth == state.framebufferWidth && state.renderHeight == state.framebufferHeight;
+    if (native)
+    {
+        // back to native after a resize or a settings change: the target is not needed any more
+        ReleaseTarget(entry);
+        GLState().BindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState().Viewport(0, 0, state.framebufferWidth, state.framebufferHeight);
+        return;
+    }
+
+    // (re)allocate lazily: resize callbacks don't run with the window's context current
+    if (entry.framebuffer == 0 || entry.targetWidth != state.renderWidth || entry.targetHeight != state.renderHeight)
+    {
+        ReleaseTarget(entry);
+        glGenFramebuffers(1, &entry.framebuffer);
+        glGenRenderbuffers(1, &entry.colorBuffer);
+        glGenRenderbuffers(1, &entry.depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, entry.colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, state.renderWidth, state.renderHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, entry.depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, state.renderWidth, state.renderHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        GLState().BindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, entry.colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, entry.depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Scene framebuffer is not complete" << std::endl;
+
+        entry.targetWidth = state.renderWidth;
+        entry.targetHeight = state.renderHeight;
+    }
+
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+    GLState().Viewport(0, 0, state.renderWidth, state.renderHeight);
+}
+
+void DisplayConfig::EndScene(GLFWwindow* window)
+{
+    Entry& entry = windows[window];
+    const DisplayState& state = entry.state;
+    if (entry.framebuffer == 0 || (state.renderWidth == state.framebufferWidth && state.renderHeight == state.framebufferHeight))
+        return;
+
+    GLState().BindFramebuffer(GL_READ_FRAMEBUFFER, entry.framebuffer);
+    GLState().BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, entry.targetWidth, entry.targetHeight,
+        0, 0, state.framebufferWidth, state.framebufferHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
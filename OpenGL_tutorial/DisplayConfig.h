@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <unordered_map>
+
+// How the internal (scene) resolution is derived from the window's framebuffer.
+//   Native:       render at framebuffer resolution.
+//   FixedScale:   render at logical resolution (framebuffer / content scale) times `scale`,
+//                 so a 4K panel at 200% and a 1080p panel at 100% cost the same at scale 1.
+//   CappedPixels: native, scaled down uniformly so the pixel count stays under `maxPixels`.
+enum class RenderScalePolicy
+{
+    Native,
+    FixedScale,
+    CappedPixels
+};
+
+struct RenderScaleSettings
+{
+    RenderScalePolicy policy = RenderScalePolicy::Native;
+    float scale = 1.0f;
+    long long maxPixels = 1920LL * 1080LL;
+};
+
+struct DisplayState
+{
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+    float contentScaleX = 1.0f;
+    float contentScaleY = 1.0f;
+    int renderWidth = 0;
+    int renderHeight = 0;
+};
+
+void ComputeRenderSize(const RenderScaleSettings& settings, DisplayState& state);
+
+// Tracks framebuffer size and content scale per window and owns the internal-resolution
+// render target of each window. When the render size matches the framebuffer the scene is
+// drawn straight into the default framebuffer and no target is allocated.
+class DisplayConfig
+{
+public:
+    // Window hints for DPI-aware windows; call before glfwCreateWindow.
+    static void ApplyWindowHints();
+
+    void SetSettings(const RenderScaleSettings& newSettings);
+    const RenderScaleSettings& Settings() const { return settings; }
+
+    void Track(GLFWwindow* window);
+    // Deletes the window's scene target and stops tracking it; the window's context must be current.
+    void Untrack(GLFWwindow* window);
+    void OnFramebufferSize(GLFWwindow* window, int width, int height);
+    void OnContentScale(GLFWwindow* window, float xscale, float yscale);
+    const DisplayState& State(GLFWwindow* window) { return windows[window].state; }
+
+    // Binds the window's scene target and sets the viewport; the window's context must be current.
+    void BeginScene(GLFWwindow* window);
+    // Upscales the scene target into the default framebuffer.
+    void EndScene(GLFWwindow* window);
+
+private:
+    struct Entry
+    {
+        DisplayState state;
+        GLuint framebuffer = 0;
+        GLuint colorBuffer = 0;
+        GLuint depthBuffer = 0;
+        int targetWidth = 0;
+        int targetHeight = 0;
+    };
+
+    void Recompute(Entry& entry);
+    // the owning window's context must be current
+    void ReleaseTarget(Entry& entry);
+
+    RenderScaleSettings settings;
+    std::unordered_map<GLFWwindow*, Entry> windows;
+};
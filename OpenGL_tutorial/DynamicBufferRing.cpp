@@ -0,0 +1,115 @@
+#include "DynamicBufferRing.h"
+
+#include "GLStateCache.h"
+
+#include <iostream>
+
+DynamicBufferRing::~DynamicBufferRing()
+{
+    Destroy();
+}
+
+bool DynamicBufferRing::Create(GLsizeiptr bytesPerFrame, unsigned int framesInFlight)
+{
+    if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage)
+    {
+        std::cout << "ARB_buffer_storage not supported, dynamic buffer ring unavailable" << std::endl;
+        return false;
+    }
+
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformAlignment = alignment;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    storageAlignment = alignment;
+
+    // regions start aligned for any use
+    GLsizeiptr regionAlignment = uniformAlignment > storageAlignment ? uniformAlignment : storageAlignment;
+    regionSize = (bytesPerFrame + regionAlignment - 1) / regionAlignment * regionAlignment;
+    fences.assign(framesInFlight, std::vector<GLsync>());
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr total = regionSize * framesInFlight;
+    glGenBuffers(1, &buffer);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+    mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!mapped)
+    {
+        std::cout << "Failed to map dynamic buffer ring" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    frame = 0;
+    frameStart = head = 0;
+    return true;
+}
+
+void DynamicBufferRing::Destroy()
+{
+    for (std::vector<GLsync>& region : fences)
+    {
+        for (GLsync fence : region)
+            glDeleteSync(fence);
+        region.clear();
+    }
+    if (buffer != 0)
+    {
+        // deleting a mapped buffer unmaps it
+        glDeleteBuffers(1, &buffer);
+        GLState().ForgetBuffer(buffer);
+        buffer = 0;
+    }
+    mapped = nullptr;
+}
+
+void DynamicBufferRing::BeginFrame()
+{
+    bool stalled = false;
+    for (GLsync fence : fences[frame])
+    {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            // the GPU is more than framesInFlight frames behind
+            stalled = true;
+            do
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            while (status == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+    }
+    if (stalled)
+        stalls++;
+    fences[frame].clear();
+    frameStart = head = regionSize * frame;
+}
+
+void DynamicBufferRing::FenceConsumer()
+{
+    fences[frame].push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void DynamicBufferRing::EndFrame()
+{
+    if (fences[frame].empty())
+        FenceConsumer();
+    frame = (frame + 1) % fences.size();
+}
+
+DynamicBufferRing::Allocation DynamicBufferRing::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    Allocation allocation;
+    GLsizeiptr offset = (head + alignment - 1) / alignment * alignment;
+    if (!mapped || offset + size > frameStart + regionSize)
+        return allocation;
+
+    head = offset + size;
+    allocation.cpu = mapped + offset;
+    allocation.buffer = buffer;
+    allocation.offset = offset;
+    allocation.size = size;
+    return allocation;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Per-frame dynamic data (uniforms, instance data, streamed vertices) written straight into a
+// persistently mapped, coherent buffer (ARB_buffer_storage).
+// The buffer is split into one region per frame in flight; each region is protected by fences
+// issued in the contexts that read it, and BeginFrame only waits if the GPU is still reading the
+// region about to be reused. This avoids the implicit synchronisation of glBufferSubData into a
+// buffer the GPU may still be using.
+class DynamicBufferRing
+{
+public:
+    struct Allocation
+    {
+        void* cpu = nullptr;      // write here; null when the frame's region is full
+        GLuint buffer = 0;
+        GLintptr offset = 0;      // for glBindBufferRange / vertex buffer offsets
+        GLsizeiptr size = 0;
+    };
+
+    ~DynamicBufferRing();
+
+    bool Create(GLsizeiptr bytesPerFrame, unsigned int framesInFlight = 3);
+    void Destroy();
+
+    void BeginFrame();
+    // Call in every context that draws from this frame's region, after its last such draw; a fence
+    // only covers the commands of the context it was issued in. The context must be flushed
+    // (SwapBuffers does it) before BeginFrame reuses the region.
+    void FenceConsumer();
+    // Fences the current context if no consumer did.
+    void EndFrame();
+
+    Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+    // Offsets that satisfy GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT / GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT.
+    Allocation AllocateUniform(GLsizeiptr size) { return Allocate(size, uniformAlignment); }
+    Allocation AllocateStorage(GLsizeiptr size) { return Allocate(size, storageAlignment); }
+
+    GLuint Buffer() const { return buffer; }
+    GLsizeiptr UsedThisFrame() const { return head - frameStart; }
+    unsigned int Stalls() const { return stalls; }
+
+private:
+    GLuint buffer = 0;
+    unsigned char* mapped = nullptr;
+    GLsizeiptr regionSize = 0;
+    std::vector<std::vector<GLsync>> fences; // per region, one per consuming context
+    unsigned int frame = 0;
+    GLsizeiptr frameStart = 0;
+    GLsizeiptr head = 0;
+    GLsizeiptr uniformAlignment = 256;
+    GLsizeiptr storageAlignment = 256;
+    unsigned int stalls = 0;
+};
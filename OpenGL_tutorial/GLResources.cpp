@@ -0,0 +1,485 @@
+#include "GLResources.h"
+
+#include "GLStateCache.h"
+
+#include <iostream>
+#include <utility>
+
+namespace
+{
+    int useDsa = -1; // decided on first use, the context has to exist
+
+    ResourceStats stats;
+
+    bool Dsa()
+    {
+        if (useDsa < 0)
+            useDsa = DirectStateAccessSupported() ? 1 : 0;
+        return useDsa == 1;
+    }
+
+    bool VertexAttribBindingSupported()
+    {
+        return GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_vertex_attrib_binding;
+    }
+
+    // fallback edits use whichever unit is active, binding on the unit first makes it known
+    void EditTexture2D(GLuint name)
+    {
+        GLStateCache& state = GLState();
+        GLuint unit = state.ActiveUnit();
+        state.ActiveTexture(unit);
+        state.BindTexture(unit, GL_TEXTURE_2D, name);
+    }
+}
+
+bool DirectStateAccessSupported()
+{
+    return GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_direct_state_access;
+}
+
+void UseDirectStateAccess(bool enable)
+{
+    useDsa = enable && DirectStateAccessSupported() ? 1 : 0;
+}
+
+bool UsingDirectStateAccess()
+{
+    return Dsa();
+}
+
+ResourceStats& GetResourceStats()
+{
+    return stats;
+}
+
+// Buffer
+// ------
+Buffer::Buffer(Buffer&& other) noexcept
+    : name(other.name), size(other.size)
+{
+    other.name = 0;
+    other.size = 0;
+}
+
+Buffer& Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        std::swap(name, other.name);
+        std::swap(size, other.size);
+    }
+    return *this;
+}
+
+bool Buffer::Create(GLsizeiptr newSize, const void* data, GLbitfield flags)
+{
+    Release();
+    stats.edits++;
+    size = newSize;
+    if (Dsa())
+    {
+        glCreateBuffers(1, &name);
+        glNamedBufferStorage(name, size, data, flags);
+        return true;
+    }
+
+    glGenBuffers(1, &name);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, name);
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage)
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, flags);
+    else
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, (flags & GL_DYNAMIC_STORAGE_BIT) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    return true;
+}
+
+void Buffer::Release()
+{
+    if (name == 0)
+        return;
+    glDeleteBuffers(1, &name);
+    GLState().ForgetBuffer(name);
+    name = 0;
+    size = 0;
+}
+
+void Buffer::SetData(GLintptr offset, GLsizeiptr length, const void* data)
+{
+    stats.edits++;
+    if (Dsa())
+        glNamedBufferSubData(name, offset, length, data);
+    else
+    {
+        GLState().BindBuffer(GL_COPY_WRITE_BUFFER, name);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, length, data);
+    }
+}
+
+void Buffer::CopyFrom(const Buffer& source, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr length)
+{
+    stats.edits++;
+    if (Dsa())
+        glCopyNamedBufferSubData(source.name, name, readOffset, writeOffset, length);
+    else
+    {
+        GLState().BindBuffer(GL_COPY_READ_BUFFER, source.name);
+        GLState().BindBuffer(GL_COPY_WRITE_BUFFER, name);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, readOffset, writeOffset, length);
+    }
+}
+
+void Buffer::BindBase(GLenum target, GLuint index) const
+{
+    GLState().BindBufferBase(target, index, name);
+}
+
+// Texture
+// -------
+Texture::Texture(Texture&& other) noexcept
+    : name(other.name), target(other.target), width(other.width), height(other.height)
+{
+    other.name = 0;
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        std::swap(name, other.name);
+        target = other.target;
+        width = other.width;
+        height = other.height;
+    }
+    return *this;
+}
+
+bool Texture::Create2D(GLenum internalFormat, GLsizei newWidth, GLsizei newHeight, GLsizei levels)
+{
+    Release();
+    stats.edits++;
+    target = GL_TEXTURE_2D;
+    width = newWidth;
+    height = newHeight;
+    if (Dsa())
+    {
+        glCreateTextures(GL_TEXTURE_2D, 1, &name);
+        glTextureStorage2D(name, levels, internalFormat, width, height);
+        return true;
+    }
+
+    if (!GLAD_GL_VERSION_4_2 && !GLAD_GL_ARB_texture_storage)
+    {
+        std::cout << "ERROR::TEXTURE ARB_texture_storage not supported" << std::endl;
+        return false;
+    }
+    glGenTextures(1, &name);
+    EditTexture2D(name);
+    glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+    return true;
+}
+
+void Texture::Release()
+{
+    if (name == 0)
+        return;
+    glDeleteTextures(1, &name);
+    GLState().ForgetTexture(name);
+    name = 0;
+}
+
+void Texture::SetImage(GLint level, GLint x, GLint y, GLsizei w, GLsizei h, GLenum format, GLenum type, const void* pixels)
+{
+    stats.edits++;
+    if (Dsa())
+        glTextureSubImage2D(name, level, x, y, w, h, format, type, pixels);
+    else
+    {
+        EditTexture2D(name);
+        glTexSubImage2D(GL_TEXTURE_2D, level, x, y, w, h, format, type, pixels);
+    }
+}
+
+void Texture::SetParameter(GLenum parameter, GLint value)
+{
+    stats.edits++;
+    if (Dsa())
+        glTextureParameteri(name, parameter, value);
+    else
+    {
+        EditTexture2D(name);
+        glTexParameteri(GL_TEXTURE_2D, parameter, value);
+    }
+}
+
+void Texture::GenerateMipmaps()
+{
+    stats.edits++;
+    if (Dsa())
+        glGenerateTextureMipmap(name);
+    else
+    {
+        EditTexture2D(name);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+void Texture::Bind(GLuint unit) const
+{
+    if (Dsa())
+        GLState().BindTextureUnit(unit, name);
+    else
+        GLState().BindTexture(unit, GL_TEXTURE_2D, name);
+}
+
+// VertexArray
+// -----------
+VertexArray::VertexArray(VertexArray&& other) noexcept
+    : name(other.name), bindings(std::move(other.bindings)), attributes(std::move(other.attributes))
+{
+    other.name = 0;
+}
+
+VertexArray& VertexArray::operator=(VertexArray&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        std::swap(name, other.name);
+        bindings = std::move(other.bindings);
+        attributes = std::move(other.attributes);
+    }
+    return *this;
+}
+
+bool VertexArray::Create()
+{
+    Release();
+    stats.edits++;
+    if (Dsa())
+        glCreateVertexArrays(1, &name);
+    else
+    {
+        glGenVertexArrays(1, &name);
+        GLState().BindVertexArray(name);
+    }
+    return true;
+}
+
+void VertexArray::Release()
+{
+    if (name == 0)
+        return;
+    glDeleteVertexArrays(1, &name);
+    GLState().ForgetVertexArray(name);
+    name = 0;
+    bindings.clear();
+    attributes.clear();
+}
+
+void VertexArray::SetVertexBuffer(GLuint binding, const Buffer& buffer, GLintptr offset, GLsizei stride, GLuint divisor)
+{
+    SetVertexBuffer(binding, buffer.Name(), offset, stride, divisor);
+}
+
+void VertexArray::SetVertexBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride, GLuint divisor)
+{
+    stats.edits++;
+    if (bindings.size() <= binding)
+        bindings.resize(binding + 1);
+    BindingDesc& desc = bindings[binding];
+    bool divisorChanged = desc.divisor != divisor;
+    desc.buffer = buffer;
+    desc.offset = offset;
+    desc.stride = stride;
+    desc.divisor = divisor;
+
+    if (Dsa())
+    {
+        glVertexArrayVertexBuffer(name, binding, desc.buffer, offset, stride);
+        if (divisorChanged)
+            glVertexArrayBindingDivisor(name, binding, divisor);
+        return;
+    }
+
+    GLState().BindVertexArray(name);
+    if (VertexAttribBindingSupported())
+    {
+        glBindVertexBuffer(binding, desc.buffer, offset, stride);
+        if (divisorChanged)
+            glVertexBindingDivisor(binding, divisor);
+        return;
+    }
+    for (GLuint attribute = 0; attribute < attributes.size(); ++attribute)
+    {
+        if (attributes[attribute].enabled && attributes[attribute].binding == binding)
+            ApplyAttribute(attribute);
+    }
+}
+
+void VertexArray::SetElementBuffer(const Buffer& buffer)
+{
+    stats.edits++;
+    if (Dsa())
+        glVertexArrayElementBuffer(name, buffer.Name());
+    else
+    {
+        // the element buffer binding is part of the vertex array, the cache passes it through
+        GLState().BindVertexArray(name);
+        GLState().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.Name());
+    }
+}
+
+void VertexArray::SetAttribute(GLuint attribute, GLuint binding, GLint size, GLenum type, GLboolean normalized,
+    GLuint relativeOffset, bool integer)
+{
+    stats.edits++;
+    if (attributes.size() <= attribute)
+        attributes.resize(attribute + 1);
+    AttributeDesc& desc = attributes[attribute];
+    bool wasEnabled = desc.enabled;
+    desc.enabled = true;
+    desc.binding = binding;
+    desc.size = size;
+    desc.type = type;
+    desc.normalized = normalized;
+    desc.relativeOffset = relativeOffset;
+    desc.integer = integer;
+
+    if (Dsa())
+    {
+        if (!wasEnabled)
+            glEnableVertexArrayAttrib(name, attribute);
+        if (integer)
+            glVertexArrayAttribIFormat(name, attribute, size, type, relativeOffset);
+        else
+            glVertexArrayAttribFormat(name, attribute, size, type, normalized, relativeOffset);
+        glVertexArrayAttribBinding(name, attribute, binding);
+        return;
+    }
+
+    GLState().BindVertexArray(name);
+    if (!wasEnabled)
+        glEnableVertexAttribArray(attribute);
+    if (VertexAttribBindingSupported())
+    {
+        if (integer)
+            glVertexAttribIFormat(attribute, size, type, relativeOffset);
+        else
+            glVertexAttribFormat(attribute, size, type, normalized, relativeOffset);
+        glVertexAttribBinding(attribute, binding);
+    }
+    else
+        ApplyAttribute(attribute);
+}
+
+void VertexArray::ApplyAttribute(GLuint attribute)
+{
+    const AttributeDesc& desc = attributes[attribute];
+    if (desc.binding >= bindings.size() || bindings[desc.binding].buffer == 0)
+        return; // specified again once the buffer is set
+    const BindingDesc& binding = bindings[desc.binding];
+
+    GLState().BindBuffer(GL_ARRAY_BUFFER, binding.buffer);
+    const void* pointer = (const void*)(binding.offset + desc.relativeOffset);
+    if (desc.integer)
+        glVertexAttribIPointer(attribute, desc.size, desc.type, binding.stride, pointer);
+    else
+        glVertexAttribPointer(attribute, desc.size, desc.type, desc.normalized, binding.stride, pointer);
+    glVertexAttribDivisor(attribute, binding.divisor);
+}
+
+void VertexArray::Bind() const
+{
+    GLState().BindVertexArray(name);
+}
+
+// Framebuffer
+// -----------
+Framebuffer::Framebuffer(Framebuffer&& other) noexcept
+    : name(other.name)
+{
+    other.name = 0;
+}
+
+Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        std::swap(name, other.name);
+    }
+    return *this;
+}
+
+bool Framebuffer::Create()
+{
+    Release();
+    stats.edits++;
+    if (Dsa())
+        glCreateFramebuffers(1, &name);
+    else
+    {
+        glGenFramebuffers(1, &name);
+        GLState().BindFramebuffer(GL_READ_FRAMEBUFFER, name);
+    }
+    return true;
+}
+
+void Framebuffer::Release()
+{
+    if (name == 0)
+        return;
+    glDeleteFramebuffers(1, &name);
+    GLState().ForgetFramebuffer(name);
+    name = 0;
+}
+
+void Framebuffer::AttachTexture(GLenum attachment, const Texture& texture, GLint level)
+{
+    stats.edits++;
+    if (Dsa())
+        glNamedFramebufferTexture(name, attachment, texture.Name(), level);
+    else
+    {
+        GLState().BindFramebuffer(GL_READ_FRAMEBUFFER, name);
+        glFramebufferTexture(GL_READ_FRAMEBUFFER, attachment, texture.Name(), level);
+    }
+}
+
+void Framebuffer::SetDrawBuffers(GLsizei count, const GLenum* buffers)
+{
+    stats.edits++;
+    if (Dsa())
+        glNamedFramebufferDrawBuffers(name, count, buffers);
+    else
+    {
+        // draw buffers can only be set on the draw binding
+        GLState().BindFramebuffer(GL_DRAW_FRAMEBUFFER, name);
+        glDrawBuffers(count, buffers);
+    }
+}
+
+bool Framebuffer::CheckStatus() const
+{
+    GLenum status;
+    if (Dsa())
+        status = glCheckNamedFramebufferStatus(name, GL_FRAMEBUFFER);
+    else
+    {
+        GLState().BindFramebuffer(GL_READ_FRAMEBUFFER, name);
+        status = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER);
+    }
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete! (0x" << std::hex << status << std::dec << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Framebuffer::Bind(GLenum target) const
+{
+    GLState().BindFramebuffer(target, name);
+}
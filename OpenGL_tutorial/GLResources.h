@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Typed, move-only owners for GL objects.
+// Objects are created and edited through direct state access (GL 4.5 / ARB_direct_state_access),
+// so editing never disturbs the bindings the renderer relies on. Older contexts fall back to
+// bind-to-edit: buffers are edited through GL_COPY_WRITE_BUFFER, framebuffers through
+// GL_READ_FRAMEBUFFER, and every bind goes through the GLStateCache of the current context so
+// a bind that would not change anything is skipped.
+
+struct ResourceStats
+{
+    unsigned long long edits = 0; // create / update / attach operations
+};
+
+bool DirectStateAccessSupported();
+// Forces the bind-to-edit path even when DSA is available (for comparison runs).
+void UseDirectStateAccess(bool enable);
+bool UsingDirectStateAccess();
+
+ResourceStats& GetResourceStats();
+
+class Buffer
+{
+public:
+    Buffer() = default;
+    ~Buffer() { Release(); }
+    Buffer(Buffer&& other) noexcept;
+    Buffer& operator=(Buffer&& other) noexcept;
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    // Immutable storage; pass GL_DYNAMIC_STORAGE_BIT to allow SetData.
+    bool Create(GLsizeiptr size, const void* data, GLbitfield flags);
+    void Release();
+
+    void SetData(GLintptr offset, GLsizeiptr size, const void* data);
+    void CopyFrom(const Buffer& source, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+
+    void BindBase(GLenum target, GLuint index) const;
+
+    GLuint Name() const { return name; }
+    GLsizeiptr Size() const { return size; }
+
+private:
+    GLuint name = 0;
+    GLsizeiptr size = 0;
+};
+
+class Texture
+{
+public:
+    Texture() = default;
+    ~Texture() { Release(); }
+    Texture(Texture&& other) noexcept;
+    Texture& operator=(Texture&& other) noexcept;
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    bool Create2D(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei levels = 1);
+    void Release();
+
+    void SetImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+    void SetParameter(GLenum parameter, GLint value);
+    void GenerateMipmaps();
+    void Bind(GLuint unit) const;
+
+    GLuint Name() const { return name; }
+    GLenum Target() const { return target; }
+    GLsizei Width() const { return width; }
+    GLsizei Height() const { return height; }
+
+private:
+    GLuint name = 0;
+    GLenum target = GL_TEXTURE_2D;
+    GLsizei width = 0;
+    GLsizei height = 0;
+};
+
+// Vertex formats are described with separate attribute formats and buffer bindings
+// (glVertexArrayAttribFormat / glVertexArrayVertexBuffer). Without ARB_vertex_attrib_binding the
+// fallback replays the description through glVertexAttribPointer.
+class VertexArray
+{
+public:
+    VertexArray() = default;
+    ~VertexArray() { Release(); }
+    VertexArray(VertexArray&& other) noexcept;
+    VertexArray& operator=(VertexArray&& other) noexcept;
+    VertexArray(const VertexArray&) = delete;
+    VertexArray& operator=(const VertexArray&) = delete;
+
+    bool Create();
+    void Release();
+
+    void SetVertexBuffer(GLuint binding, const Buffer& buffer, GLintptr offset, GLsizei stride, GLuint divisor = 0);
+    // for buffers owned elsewhere, e.g. a DynamicBufferRing
+    void SetVertexBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride, GLuint divisor = 0);
+    void SetElementBuffer(const Buffer& buffer);
+    // `integer` keeps integer types unconverted (glVertexArrayAttribIFormat).
+    void SetAttribute(GLuint attribute, GLuint binding, GLint size, GLenum type, GLboolean normalized,
+        GLuint relativeOffset, bool integer = false);
+    void Bind() const;
+
+    GLuint Name() const { return name; }
+
+private:
+    struct BindingDesc
+    {
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizei stride = 0;
+        GLuint divisor = 0;
+    };
+
+    struct AttributeDesc
+    {
+        bool enabled = false;
+        GLuint binding = 0;
+        GLint size = 4;
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_FALSE;
+        GLuint relativeOffset = 0;
+        bool integer = false;
+    };
+
+    void ApplyAttribute(GLuint attribute); // fallback without ARB_vertex_attrib_binding
+
+    GLuint name = 0;
+    std::vector<BindingDesc> bindings;
+    std::vector<AttributeDesc> attributes;
+};
+
+class Framebuffer
+{
+public:
+    Framebuffer() = default;
+    ~Framebuffer() { Release(); }
+    Framebuffer(Framebuffer&& other) noexcept;
+    Framebuffer& operator=(Framebuffer&& other) noexcept;
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    bool Create();
+    void Release();
+
+    void AttachTexture(GLenum attachment, const Texture& texture, GLint level = 0);
+    void SetDrawBuffers(GLsizei count, const GLenum* buffers);
+    // Prints the incomplete status; returns true when complete.
+    bool CheckStatus() const;
+    void Bind(GLenum target = GL_FRAMEBUFFER) const;
+
+    GLuint Name() const { return name; }
+
+private:
+    GLuint name = 0;
+};
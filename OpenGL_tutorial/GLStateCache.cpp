@@ -0,0 +1,477 @@
+#include "GLStateCache.h"
+
+#include <cstring>
+#include <map>
+
+namespace
+{
+    const GLenum BUFFER_TARGETS[14] = {
+        GL_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_PIXEL_PACK_BUFFER,
+        GL_PIXEL_UNPACK_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_DISPATCH_INDIRECT_BUFFER, GL_PARAMETER_BUFFER,
+        GL_QUERY_BUFFER, GL_TEXTURE_BUFFER, GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER,
+        GL_ATOMIC_COUNTER_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER,
+    };
+
+    const GLenum CAPABILITIES[10] = {
+        GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+        GL_FRAMEBUFFER_SRGB, GL_MULTISAMPLE, GL_POLYGON_OFFSET_FILL, GL_RASTERIZER_DISCARD,
+        GL_PRIMITIVE_RESTART_FIXED_INDEX,
+    };
+
+    unsigned long long requests = 0;
+    unsigned long long filtered = 0;
+    unsigned long long requestsLastFrame = 0;
+    unsigned long long filteredLastFrame = 0;
+    unsigned long long totalRequests = 0;
+    unsigned long long totalFiltered = 0;
+
+    std::map<GLFWwindow*, GLStateCache> caches;
+    GLStateCache noContext;
+    GLStateCache* current = &noContext;
+
+    std::vector<GLStateCache*> OtherCaches(const GLStateCache* self)
+    {
+        std::vector<GLStateCache*> others;
+        for (auto& entry : caches)
+        {
+            if (&entry.second != self)
+                others.push_back(&entry.second);
+        }
+        if (&noContext != self)
+            others.push_back(&noContext);
+        return others;
+    }
+}
+
+GLStateCache::GLStateCache()
+{
+    Invalidate();
+}
+
+void GLStateCache::Invalidate()
+{
+    program = pipeline = vertexArray = UNKNOWN;
+    for (GLuint& buffer : buffers)
+        buffer = UNKNOWN;
+    uniformBuffers.clear();
+    storageBuffers.clear();
+    atomicCounterBuffers.clear();
+    feedbackBuffers.clear();
+    activeUnit = UNKNOWN;
+    textures.clear();
+    readFramebuffer = drawFramebuffer = UNKNOWN;
+
+    viewport[0] = viewport[1] = viewport[2] = viewport[3] = -1;
+    memset(capabilities, -1, sizeof(capabilities));
+    blend[0] = blend[1] = blend[2] = blend[3] = UNKNOWN;
+    blendEquation = depthFunction = cullFace = UNKNOWN;
+    depthMask = -1;
+    memset(colorMask, -1, sizeof(colorMask));
+}
+
+bool GLStateCache::Filter(bool unchanged)
+{
+    requests++;
+    if (unchanged)
+        filtered++;
+    return unchanged;
+}
+
+GLuint* GLStateCache::BufferSlot(GLenum target)
+{
+    for (int i = 0; i < 14; ++i)
+    {
+        if (BUFFER_TARGETS[i] == target)
+            return &buffers[i];
+    }
+    return nullptr;
+}
+
+std::vector<GLStateCache::IndexedBinding>* GLStateCache::IndexedSlots(GLenum target)
+{
+    switch (target)
+    {
+    case GL_UNIFORM_BUFFER:            return &uniformBuffers;
+    case GL_SHADER_STORAGE_BUFFER:     return &storageBuffers;
+    case GL_ATOMIC_COUNTER_BUFFER:     return &atomicCounterBuffers;
+    case GL_TRANSFORM_FEEDBACK_BUFFER: return &feedbackBuffers;
+    default:                           return nullptr;
+    }
+}
+
+signed char* GLStateCache::CapabilitySlot(GLenum capability)
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        if (CAPABILITIES[i] == capability)
+            return &capabilities[i];
+    }
+    return nullptr;
+}
+
+void GLStateCache::UseProgram(GLuint newProgram)
+{
+    if (Filter(program == newProgram))
+        return;
+    program = newProgram;
+    glUseProgram(newProgram);
+}
+
+void GLStateCache::BindProgramPipeline(GLuint newPipeline)
+{
+    if (Filter(pipeline == newPipeline))
+        return;
+    pipeline = newPipeline;
+    glBindProgramPipeline(newPipeline);
+}
+
+void GLStateCache::BindVertexArray(GLuint newVertexArray)
+{
+    if (Filter(vertexArray == newVertexArray))
+        return;
+    vertexArray = newVertexArray;
+    glBindVertexArray(newVertexArray);
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint* slot = BufferSlot(target);
+    if (Filter(slot && *slot == buffer))
+        return;
+    if (slot)
+        *slot = buffer;
+    glBindBuffer(target, buffer);
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    BindBufferRange(target, index, buffer, 0, 0);
+}
+
+void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    // size 0 stands for the whole buffer (glBindBufferBase)
+    std::vector<IndexedBinding>* slots = IndexedSlots(target);
+    if (slots && slots->size() <= index)
+        slots->resize(index + 1, { UNKNOWN, 0, 0 });
+    IndexedBinding* slot = slots ? &(*slots)[index] : nullptr;
+    if (Filter(slot && slot->buffer == buffer && slot->offset == offset && slot->size == size))
+        return;
+    if (slot)
+        *slot = { buffer, offset, size };
+    // indexed binds also replace the generic binding
+    if (GLuint* generic = BufferSlot(target))
+        *generic = buffer;
+
+    if (size == 0)
+        glBindBufferBase(target, index, buffer);
+    else
+        glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLStateCache::ActiveTexture(GLuint unit)
+{
+    if (Filter(activeUnit == unit))
+        return;
+    activeUnit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    // one slot per unit: binding another target on the unit makes the first one unknown
+    if (textures.size() <= unit)
+        textures.resize(unit + 1, { UNKNOWN, GL_NONE });
+    TextureSlot& slot = textures[unit];
+    if (Filter(slot.texture == texture && slot.target == target))
+        return;
+    slot = { texture, target };
+    // a request of its own, so requests - filtered stays the number of calls issued
+    ActiveTexture(unit);
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::BindTextureUnit(GLuint unit, GLuint texture)
+{
+    if (textures.size() <= unit)
+        textures.resize(unit + 1, { UNKNOWN, GL_NONE });
+    TextureSlot& slot = textures[unit];
+    // a non-zero name is always bound to its own target, whichever call bound it
+    if (Filter(slot.texture == texture && texture != 0))
+        return;
+    slot = { texture, GL_NONE };
+    glBindTextureUnit(unit, texture);
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    if (Filter((!read || readFramebuffer == framebuffer) && (!draw || drawFramebuffer == framebuffer)))
+        return;
+    if (read)
+        readFramebuffer = framebuffer;
+    if (draw)
+        drawFramebuffer = framebuffer;
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (Filter(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height))
+        return;
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = width;
+    viewport[3] = height;
+    glViewport(x, y, width, height);
+}
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled)
+{
+    signed char* slot = CapabilitySlot(capability);
+    if (Filter(slot && *slot == (signed char)enabled))
+        return;
+    if (slot)
+        *slot = enabled;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLStateCache::BlendFuncSeparate(GLenum sourceRgb, GLenum destinationRgb, GLenum sourceAlpha, GLenum destinationAlpha)
+{
+    if (Filter(blend[0] == sourceRgb && blend[1] == destinationRgb && blend[2] == sourceAlpha && blend[3] == destinationAlpha))
+        return;
+    blend[0] = sourceRgb;
+    blend[1] = destinationRgb;
+    blend[2] = sourceAlpha;
+    blend[3] = destinationAlpha;
+    glBlendFuncSeparate(sourceRgb, destinationRgb, sourceAlpha, destinationAlpha);
+}
+
+void GLStateCache::BlendEquation(GLenum mode)
+{
+    if (Filter(blendEquation == mode))
+        return;
+    blendEquation = mode;
+    glBlendEquation(mode);
+}
+
+void GLStateCache::DepthFunc(GLenum function)
+{
+    if (Filter(depthFunction == function))
+        return;
+    depthFunction = function;
+    glDepthFunc(function);
+}
+
+void GLStateCache::DepthMask(bool write)
+{
+    if (Filter(depthMask == (signed char)write))
+        return;
+    depthMask = write;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::ColorMask(bool red, bool green, bool blue, bool alpha)
+{
+    if (Filter(colorMask[0] == (signed char)red && colorMask[1] == (signed char)green
+        && colorMask[2] == (signed char)blue && colorMask[3] == (signed char)alpha))
+        return;
+    colorMask[0] = red;
+    colorMask[1] = green;
+    colorMask[2] = blue;
+    colorMask[3] = alpha;
+    glColorMask(red, green, blue, alpha);
+}
+
+void GLStateCache::CullFace(GLenum face)
+{
+    if (Filter(cullFace == face))
+        return;
+    cullFace = face;
+    glCullFace(face);
+}
+
+void GLStateCache::ForgetBuffer(GLuint buffer)
+{
+    ReplaceBuffer(buffer, 0);
+    for (GLStateCache* other : OtherCaches(this))
+        other->ReplaceBuffer(buffer, UNKNOWN);
+}
+
+void GLStateCache::ForgetTexture(GLuint texture)
+{
+    ReplaceTexture(texture, 0);
+    for (GLStateCache* other : OtherCaches(this))
+        other->ReplaceTexture(texture, UNKNOWN);
+}
+
+void GLStateCache::ReplaceBuffer(GLuint buffer, GLuint replacement)
+{
+    for (GLuint& slot : buffers)
+    {
+        if (slot == buffer)
+            slot = replacement;
+    }
+    for (std::vector<IndexedBinding>* slots : { &uniformBuffers, &storageBuffers, &atomicCounterBuffers, &feedbackBuffers })
+    {
+        for (IndexedBinding& slot : *slots)
+        {
+            if (slot.buffer == buffer)
+                slot = { replacement, 0, 0 };
+        }
+    }
+}
+
+void GLStateCache::ReplaceTexture(GLuint texture, GLuint replacement)
+{
+    for (TextureSlot& slot : textures)
+    {
+        if (slot.texture == texture)
+            slot.texture = replacement;
+    }
+}
+
+void GLStateCache::ForgetVertexArray(GLuint deleted)
+{
+    if (vertexArray == deleted)
+        vertexArray = 0;
+}
+
+void GLStateCache::ForgetFramebuffer(GLuint framebuffer)
+{
+    if (readFramebuffer == framebuffer)
+        readFramebuffer = 0;
+    if (drawFramebuffer == framebuffer)
+        drawFramebuffer = 0;
+}
+
+GLuint GLStateCache::ActiveUnit() const
+{
+    return activeUnit == UNKNOWN ? 0 : activeUnit;
+}
+
+void GLStateCache::BeginFrame()
+{
+    requestsLastFrame = requests;
+    filteredLastFrame = filtered;
+    totalRequests += requests;
+    totalFiltered += filtered;
+    requests = filtered = 0;
+}
+
+unsigned long long GLStateCache::RequestsLastFrame()
+{
+    return requestsLastFrame;
+}
+
+unsigned long long GLStateCache::FilteredLastFrame()
+{
+    return filteredLastFrame;
+}
+
+double GLStateCache::FilteredPercentLastFrame()
+{
+    return requestsLastFrame ? 100.0 * filteredLastFrame / requestsLastFrame : 0.0;
+}
+
+unsigned long long GLStateCache::TotalRequests()
+{
+    return totalRequests + requests;
+}
+
+unsigned long long GLStateCache::TotalFiltered()
+{
+    return totalFiltered + filtered;
+}
+
+GLStateCache& GLState()
+{
+    return *current;
+}
+
+void SelectStateCache(GLFWwindow* context)
+{
+    current = context ? &caches[context] : &noContext;
+}
+
+void ReleaseStateCache(GLFWwindow* context)
+{
+    if (current == &caches[context])
+        current = &noContext;
+    caches.erase(context);
+}
+
+// driver call counting
+// --------------------
+namespace
+{
+    // per thread: the loader thread's raw binds are not the render thread's cache's business
+    thread_local unsigned long long driverCalls = 0;
+
+#define COUNTED_ENTRY_POINT(Name, Proc, Params, Args) \
+    Proc real_##Name = nullptr; \
+    void APIENTRY Counted_##Name Params { driverCalls++; real_##Name Args; }
+
+    COUNTED_ENTRY_POINT(glUseProgram, PFNGLUSEPROGRAMPROC, (GLuint p), (p))
+    COUNTED_ENTRY_POINT(glBindProgramPipeline, PFNGLBINDPROGRAMPIPELINEPROC, (GLuint p), (p))
+    COUNTED_ENTRY_POINT(glBindVertexArray, PFNGLBINDVERTEXARRAYPROC, (GLuint a), (a))
+    COUNTED_ENTRY_POINT(glBindBuffer, PFNGLBINDBUFFERPROC, (GLenum t, GLuint b), (t, b))
+    COUNTED_ENTRY_POINT(glBindBufferBase, PFNGLBINDBUFFERBASEPROC, (GLenum t, GLuint i, GLuint b), (t, i, b))
+    COUNTED_ENTRY_POINT(glBindBufferRange, PFNGLBINDBUFFERRANGEPROC, (GLenum t, GLuint i, GLuint b, GLintptr o, GLsizeiptr s), (t, i, b, o, s))
+    COUNTED_ENTRY_POINT(glActiveTexture, PFNGLACTIVETEXTUREPROC, (GLenum u), (u))
+    COUNTED_ENTRY_POINT(glBindTexture, PFNGLBINDTEXTUREPROC, (GLenum t, GLuint x), (t, x))
+    COUNTED_ENTRY_POINT(glBindTextureUnit, PFNGLBINDTEXTUREUNITPROC, (GLuint u, GLuint x), (u, x))
+    COUNTED_ENTRY_POINT(glBindFramebuffer, PFNGLBINDFRAMEBUFFERPROC, (GLenum t, GLuint f), (t, f))
+    COUNTED_ENTRY_POINT(glViewport, PFNGLVIEWPORTPROC, (GLint x, GLint y, GLsizei w, GLsizei h), (x, y, w, h))
+    COUNTED_ENTRY_POINT(glEnable, PFNGLENABLEPROC, (GLenum c), (c))
+    COUNTED_ENTRY_POINT(glDisable, PFNGLDISABLEPROC, (GLenum c), (c))
+    COUNTED_ENTRY_POINT(glBlendFuncSeparate, PFNGLBLENDFUNCSEPARATEPROC, (GLenum a, GLenum b, GLenum c, GLenum d), (a, b, c, d))
+    COUNTED_ENTRY_POINT(glBlendEquation, PFNGLBLENDEQUATIONPROC, (GLenum m), (m))
+    COUNTED_ENTRY_POINT(glDepthFunc, PFNGLDEPTHFUNCPROC, (GLenum f), (f))
+    COUNTED_ENTRY_POINT(glDepthMask, PFNGLDEPTHMASKPROC, (GLboolean w), (w))
+    COUNTED_ENTRY_POINT(glColorMask, PFNGLCOLORMASKPROC, (GLboolean r, GLboolean g, GLboolean b, GLboolean a), (r, g, b, a))
+    COUNTED_ENTRY_POINT(glCullFace, PFNGLCULLFACEPROC, (GLenum f), (f))
+
+#undef COUNTED_ENTRY_POINT
+}
+
+void CountDriverCalls()
+{
+#define INSTALL_COUNTER(Name) \
+    if (real_##Name == nullptr && glad_##Name != nullptr) \
+    { \
+        real_##Name = glad_##Name; \
+        glad_##Name = Counted_##Name; \
+    }
+
+    INSTALL_COUNTER(glUseProgram)
+    INSTALL_COUNTER(glBindProgramPipeline)
+    INSTALL_COUNTER(glBindVertexArray)
+    INSTALL_COUNTER(glBindBuffer)
+    INSTALL_COUNTER(glBindBufferBase)
+    INSTALL_COUNTER(glBindBufferRange)
+    INSTALL_COUNTER(glActiveTexture)
+    INSTALL_COUNTER(glBindTexture)
+    INSTALL_COUNTER(glBindTextureUnit)
+    INSTALL_COUNTER(glBindFramebuffer)
+    INSTALL_COUNTER(glViewport)
+    INSTALL_COUNTER(glEnable)
+    INSTALL_COUNTER(glDisable)
+    INSTALL_COUNTER(glBlendFuncSeparate)
+    INSTALL_COUNTER(glBlendEquation)
+    INSTALL_COUNTER(glDepthFunc)
+    INSTALL_COUNTER(glDepthMask)
+    INSTALL_COUNTER(glColorMask)
+    INSTALL_COUNTER(glCullFace)
+
+#undef INSTALL_COUNTER
+}
+
+unsigned long long DriverCalls()
+{
+    return driverCalls;
+}
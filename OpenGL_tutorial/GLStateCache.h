@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct GLFWwindow;
+
+// Shadow of the GL state the renderer changes most often: program, vertex array, buffer,
+// texture and framebuffer bindings, viewport, capabilities and blend/depth/cull state.
+// A call that would set a value the context already has is dropped before it reaches the
+// driver. Values start out unknown, so the first call after an invalidation always goes through.
+// Every context gets its own cache; SetActiveWindow selects it. Code that changes this state
+// without going through the cache (a library, a raw gl* call) must call Invalidate afterwards.
+// Render thread only.
+class GLStateCache
+{
+public:
+    GLStateCache();
+
+    void Invalidate();
+
+    void UseProgram(GLuint program);
+    void BindProgramPipeline(GLuint pipeline);
+    void BindVertexArray(GLuint vertexArray);
+    // GL_ELEMENT_ARRAY_BUFFER belongs to the vertex array and is passed through.
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void ActiveTexture(GLuint unit);
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+    // GL 4.5: binds to the texture's own target without changing the active unit.
+    void BindTextureUnit(GLuint unit, GLuint texture);
+    void BindFramebuffer(GLenum target, GLuint framebuffer);
+
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void SetEnabled(GLenum capability, bool enabled);
+    void BlendFunc(GLenum source, GLenum destination) { BlendFuncSeparate(source, destination, source, destination); }
+    void BlendFuncSeparate(GLenum sourceRgb, GLenum destinationRgb, GLenum sourceAlpha, GLenum destinationAlpha);
+    void BlendEquation(GLenum mode);
+    void DepthFunc(GLenum function);
+    void DepthMask(bool write);
+    void ColorMask(bool red, bool green, bool blue, bool alpha);
+    void CullFace(GLenum face);
+
+    // Deleting an object unbinds it from the current context. Buffers and textures are shared:
+    // other contexts keep the deleted object bound, and its name can come back from glGen*/glCreate*
+    // for a new object, so their caches stop trusting it.
+    void ForgetBuffer(GLuint buffer);
+    void ForgetTexture(GLuint texture);
+    // Vertex arrays and framebuffers are container objects, their names belong to one context.
+    void ForgetVertexArray(GLuint vertexArray);
+    void ForgetFramebuffer(GLuint framebuffer);
+
+    // Active unit, or 0 while unknown.
+    GLuint ActiveUnit() const;
+
+    // Statistics cover every context. Rolls the per-frame counters; call once per frame.
+    static void BeginFrame();
+    static unsigned long long RequestsLastFrame();
+    static unsigned long long FilteredLastFrame();
+    static double FilteredPercentLastFrame();
+    static unsigned long long TotalRequests();
+    static unsigned long long TotalFiltered();
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+    struct IndexedBinding
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    struct TextureSlot
+    {
+        GLuint texture;
+        GLenum target; // GL_NONE when bound through BindTextureUnit
+    };
+
+    static bool Filter(bool unchanged);
+    GLuint* BufferSlot(GLenum target);
+    std::vector<IndexedBinding>* IndexedSlots(GLenum target);
+    signed char* CapabilitySlot(GLenum capability);
+    void ReplaceBuffer(GLuint buffer, GLuint replacement);
+    void ReplaceTexture(GLuint texture, GLuint replacement);
+
+    GLuint program;
+    GLuint pipeline;
+    GLuint vertexArray;
+    GLuint buffers[14];
+    std::vector<IndexedBinding> uniformBuffers, storageBuffers, atomicCounterBuffers, feedbackBuffers;
+    GLuint activeUnit;
+    std::vector<TextureSlot> textures;
+    GLuint readFramebuffer;
+    GLuint drawFramebuffer;
+
+    GLint viewport[4];
+    signed char capabilities[10]; // -1 unknown
+    GLenum blend[4];
+    GLenum blendEquation;
+    GLenum depthFunction;
+    signed char depthMask;
+    signed char colorMask[4];
+    GLenum cullFace;
+};
+
+// The cache of the current context.
+GLStateCache& GLState();
+// Called by SetActiveWindow; a context seen for the first time starts with everything unknown.
+void SelectStateCache(GLFWwindow* context);
+void ReleaseStateCache(GLFWwindow* context);
+
+// Replaces the glad entry points the cache wraps with versions that count the calls reaching
+// the driver, to measure how much the cache filters.
+void CountDriverCalls();
+// Calls made on the calling thread. Once every state change goes through the cache,
+// TotalRequests() - TotalFiltered() grows by exactly as much.
+unsigned long long DriverCalls();
@@ -0,0 +1,132 @@
+#include "GpuHeap.h"
+#include "ContextConfig.h"
+#include "GLStateCache.h"
+
+#include <chrono>
+#include <iostream>
+
+GpuHeap::~GpuHeap()
+{
+    Destroy();
+}
+
+bool GpuHeap::Create(GLsizeiptr capacity, uint32_t granularity)
+{
+    if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage)
+    {
+        std::cout << "ARB_buffer_storage not supported, GPU heap unavailable" << std::endl;
+        return false;
+    }
+
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformAlignment = alignment;
+
+    // errors left behind by earlier calls must not be taken for this one; a no-error context
+    // reports nothing, there the size of the storage tells
+    bool checkErrors = !CurrentContextIsNoError();
+    if (checkErrors)
+    {
+        while (glGetError() != GL_NO_ERROR)
+            ;
+    }
+    glGenBuffers(1, &buffer);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_DYNAMIC_STORAGE_BIT);
+    GLint64 reserved = 0;
+    glGetBufferParameteri64v(GL_COPY_WRITE_BUFFER, GL_BUFFER_SIZE, &reserved);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if ((checkErrors && glGetError() == GL_OUT_OF_MEMORY) || reserved != capacity)
+    {
+        std::cout << "Failed to reserve " << capacity << " bytes for the GPU heap" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    allocator.Reset(capacity, granularity);
+    return true;
+}
+
+void GpuHeap::Destroy()
+{
+    if (buffer != 0)
+    {
+        glDeleteBuffers(1, &buffer);
+        GLState().ForgetBuffer(buffer);
+    }
+    if (scratch != 0)
+    {
+        glDeleteBuffers(1, &scratch);
+        GLState().ForgetBuffer(scratch);
+    }
+    buffer = scratch = 0;
+    scratchSize = 0;
+    allocator.Reset(0);
+}
+
+GpuHeap::Handle GpuHeap::Allocate(GLsizeiptr size, GLsizeiptr alignment, const void* data)
+{
+    auto start = std::chrono::steady_clock::now();
+    TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+    allocationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    allocations++;
+
+    if (allocation.block == INVALID)
+        return INVALID;
+    if (data)
+        Update(allocation.block, 0, size, data);
+    return allocation.block;
+}
+
+void GpuHeap::Update(Handle handle, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, Offset(handle) + offset, size, data);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuHeap::Free(Handle handle)
+{
+    allocator.Free(handle);
+}
+
+uint64_t GpuHeap::Defragment(uint64_t budget)
+{
+    std::vector<TlsfAllocator::Move> moves = allocator.Compact(budget);
+    if (moves.empty())
+        return 0;
+
+    uint64_t moved = 0;
+    GLState().BindBuffer(GL_COPY_READ_BUFFER, buffer);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    for (const TlsfAllocator::Move& move : moves)
+    {
+        if (move.to + move.size <= move.from)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, move.from, move.to, move.size);
+        else
+        {
+            // GL rejects overlapping copies within one buffer, bounce through scratch
+            if (scratchSize < (GLsizeiptr)move.size)
+            {
+                if (scratch != 0)
+                {
+                    glDeleteBuffers(1, &scratch);
+                    GLState().ForgetBuffer(scratch);
+                }
+                glGenBuffers(1, &scratch);
+                GLState().BindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+                glBufferStorage(GL_COPY_WRITE_BUFFER, move.size, NULL, 0);
+                GLState().BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+                scratchSize = move.size;
+            }
+            glCopyNamedBufferSubData(buffer, scratch, move.from, 0, move.size);
+            glCopyNamedBufferSubData(scratch, buffer, 0, move.to, move.size);
+        }
+        moved += move.size;
+    }
+    GLState().BindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    generation++;
+    return moved;
+}
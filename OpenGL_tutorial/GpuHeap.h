@@ -0,0 +1,51 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+
+#include <glad/glad.h>
+
+// One large immutable GL buffer sub-allocated with a TLSF allocator, so meshes and uniform
+// blocks share a buffer object instead of each paying for glGenBuffers/glBufferData and a bind.
+// Vertex, index and uniform ranges can live in the same heap.
+// Defragment slides live ranges down with glCopyBufferSubData, a budget of bytes per frame;
+// offsets of moved ranges change, so read them through Offset() when drawing (or re-read
+// them whenever Generation() changes). Queued StagingUploader writes take the heap and handle
+// for the same reason.
+class GpuHeap
+{
+public:
+    typedef uint32_t Handle;
+    static const Handle INVALID = TlsfAllocator::INVALID;
+
+    ~GpuHeap();
+
+    bool Create(GLsizeiptr capacity, uint32_t granularity = 16);
+    void Destroy();
+
+    // Uploads `data` when given. Returns INVALID when the heap is full.
+    Handle Allocate(GLsizeiptr size, GLsizeiptr alignment = 0, const void* data = nullptr);
+    Handle AllocateUniform(GLsizeiptr size, const void* data = nullptr) { return Allocate(size, uniformAlignment, data); }
+    void Update(Handle handle, GLintptr offset, GLsizeiptr size, const void* data);
+    void Free(Handle handle);
+
+    GLuint Buffer() const { return buffer; }
+    GLintptr Offset(Handle handle) const { return (GLintptr)allocator.Offset(handle); }
+
+    // Returns the number of bytes moved.
+    uint64_t Defragment(uint64_t budget);
+    unsigned int Generation() const { return generation; }
+
+    double Fragmentation() const { return allocator.Fragmentation(); }
+    uint64_t Used() const { return allocator.Used(); }
+    double AverageAllocationMicroseconds() const { return allocations ? allocationSeconds * 1e6 / allocations : 0.0; }
+
+private:
+    TlsfAllocator allocator;
+    GLuint buffer = 0;
+    GLuint scratch = 0; // for moves whose source and destination overlap
+    GLsizeiptr scratchSize = 0;
+    GLsizeiptr uniformAlignment = 256;
+    unsigned int generation = 0;
+    unsigned long long allocations = 0;
+    double allocationSeconds = 0.0;
+};
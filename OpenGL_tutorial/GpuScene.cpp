@@ -0,0 +1,239 @@
+#include "GpuScene.h"
+
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    const GLuint CULL_GROUP_SIZE = 64; // local_size_x in gpu_cull.comp
+
+    // DrawElementsIndirectCommand
+    struct IndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+}
+
+bool GpuScene::Create(GLsizei vertexCapacity, GLsizei indexCapacity, GLsizei meshCapacity, GLsizei objectCapacity)
+{
+    if (!GLAD_GL_VERSION_4_3)
+    {
+        std::cout << "ERROR::GPU_SCENE::COMPUTE_AND_MULTI_DRAW_INDIRECT_NOT_SUPPORTED" << std::endl;
+        return false;
+    }
+
+    if (GLAD_GL_VERSION_4_6)
+        indirectCount = glMultiDrawElementsIndirectCount;
+    else if (GLAD_GL_ARB_indirect_parameters)
+        indirectCount = glMultiDrawElementsIndirectCountARB;
+
+    maxVertices = vertexCapacity;
+    maxIndices = indexCapacity;
+    maxMeshes = meshCapacity;
+    maxObjects = objectCapacity;
+
+    std::vector<GLuint> ids(objectCapacity);
+    for (GLsizei i = 0; i < objectCapacity; ++i)
+        ids[i] = (GLuint)i;
+
+    bool created = vertices.Create(vertexCapacity * 3 * sizeof(float), nullptr, GL_DYNAMIC_STORAGE_BIT)
+        && indices.Create(indexCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT)
+        && meshBuffer.Create(meshCapacity * sizeof(MeshRecord), nullptr, GL_DYNAMIC_STORAGE_BIT)
+        && objectBuffer.Create(objectCapacity * sizeof(ObjectRecord), nullptr, GL_DYNAMIC_STORAGE_BIT)
+        && objectIds.Create(objectCapacity * sizeof(GLuint), ids.data(), 0)
+        && commands.Create(objectCapacity * sizeof(IndirectCommand), nullptr, 0)
+        && drawCount.Create(sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT)
+        && camera.Create(sizeof(CameraBlock), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    if (!created)
+    {
+        std::cout << "ERROR::GPU_SCENE::BUFFER_CREATION_FAILED" << std::endl;
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void GpuScene::Destroy()
+{
+    vertices.Release();
+    indices.Release();
+    meshBuffer.Release();
+    objectBuffer.Release();
+    objectIds.Release();
+    commands.Release();
+    drawCount.Release();
+    camera.Release();
+    meshes.clear();
+    objects.clear();
+    uploadedObjects = 0;
+    vertexCount = 0;
+    indexCount = 0;
+}
+
+int GpuScene::AddMesh(const float* positions, GLsizei meshVertices, const GLuint* meshIndices, GLsizei meshIndexCount)
+{
+    if ((GLsizei)meshes.size() >= maxMeshes || vertexCount + meshVertices > maxVertices || indexCount + meshIndexCount > maxIndices)
+        return -1;
+
+    // bounding sphere around the mesh origin, objects are placed by translating and scaling it
+    float radius = 0.0f;
+    for (GLsizei i = 0; i < meshVertices; ++i)
+    {
+        const float* p = positions + i * 3;
+        radius = std::max(radius, std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+    }
+
+    MeshRecord mesh = { (GLuint)meshIndexCount, (GLuint)indexCount, vertexCount, radius };
+    vertices.SetData(vertexCount * 3 * sizeof(float), meshVertices * 3 * sizeof(float), positions);
+    indices.SetData(indexCount * sizeof(GLuint), meshIndexCount * sizeof(GLuint), meshIndices);
+    meshBuffer.SetData(meshes.size() * sizeof(MeshRecord), sizeof(MeshRecord), &mesh);
+
+    vertexCount += meshVertices;
+    indexCount += meshIndexCount;
+    meshes.push_back(mesh);
+    return (int)meshes.size() - 1;
+}
+
+int GpuScene::AddObject(int mesh, const float position[3], float scale)
+{
+    if ((GLsizei)objects.size() >= maxObjects || mesh < 0 || mesh >= (int)meshes.size())
+        return -1;
+
+    // uploaded in one go by the next Cull or draw
+    ObjectRecord object = { { position[0], position[1], position[2], scale }, (GLuint)mesh, {} };
+    objects.push_back(object);
+    return (int)objects.size() - 1;
+}
+
+void GpuScene::SetupVertexArray(VertexArray& vertexArray) const
+{
+    vertexArray.SetElementBuffer(indices);
+    vertexArray.SetVertexBuffer(0, vertices, 0, 3 * sizeof(float));
+    vertexArray.SetAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    // one id per instance: baseInstance selects the object
+    vertexArray.SetVertexBuffer(1, objectIds, 0, sizeof(GLuint), 1);
+    vertexArray.SetAttribute(1, 1, 1, GL_UNSIGNED_INT, GL_FALSE, 0, true);
+}
+
+void GpuScene::SetCamera(const float viewProjection[16])
+{
+    std::copy(viewProjection, viewProjection + 16, cameraBlock.viewProjection);
+
+    // Gribb-Hartmann: each plane is the last row of the matrix plus or minus another row
+    const float* m = viewProjection;
+    for (int plane = 0; plane < 6; ++plane)
+    {
+        int row = plane / 2;
+        float sign = (plane & 1) ? -1.0f : 1.0f;
+        float* p = cameraBlock.frustum[plane];
+        for (int column = 0; column < 4; ++column)
+            p[column] = m[column * 4 + 3] + sign * m[column * 4 + row];
+        float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        for (int column = 0; column < 4; ++column)
+            p[column] /= length;
+    }
+}
+
+void GpuScene::UploadObjects()
+{
+    if (uploadedObjects == objects.size())
+        return;
+    objectBuffer.SetData(uploadedObjects * sizeof(ObjectRecord), (objects.size() - uploadedObjects) * sizeof(ObjectRecord),
+        objects.data() + uploadedObjects);
+    uploadedObjects = objects.size();
+}
+
+bool GpuScene::Visible(const ObjectRecord& object) const
+{
+    const float* center = object.positionScale;
+    float radius = meshes[object.mesh].radius * object.positionScale[3];
+    for (const float* plane : cameraBlock.frustum)
+    {
+        if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] < -radius)
+            return false;
+    }
+    return true;
+}
+
+void GpuScene::Cull(ComputeScheduler& scheduler, GLuint cullProgram)
+{
+    if (objects.empty())
+        return;
+
+    UploadObjects();
+    cameraBlock.objectCount = (GLuint)objects.size();
+    cameraBlock.compact = indirectCount != nullptr;
+    camera.SetData(0, sizeof(CameraBlock), &cameraBlock);
+    if (cameraBlock.compact)
+    {
+        // last frame's cull incremented the counter in a shader
+        scheduler.Consume(drawCount.Name(), ResourceUsage::BufferUpdate);
+        GLuint zero = 0;
+        drawCount.SetData(0, sizeof(GLuint), &zero);
+    }
+
+    ComputePass pass;
+    pass.name = "gpu cull";
+    pass.program = cullProgram;
+    pass.resources = {
+        { objectBuffer.Name(), ResourceUsage::StorageBuffer, ResourceAccess::Read, OBJECT_BINDING },
+        { meshBuffer.Name(), ResourceUsage::StorageBuffer, ResourceAccess::Read, MESH_BINDING },
+        { commands.Name(), ResourceUsage::StorageBuffer, ResourceAccess::Write, COMMAND_BINDING },
+        { drawCount.Name(), ResourceUsage::StorageBuffer, ResourceAccess::ReadWrite, COUNT_BINDING },
+        { camera.Name(), ResourceUsage::UniformBuffer, ResourceAccess::Read, CAMERA_BINDING },
+    };
+    pass.groups[0] = ((GLuint)objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+    scheduler.Dispatch(pass);
+}
+
+void GpuScene::BindSceneBuffers(GLStateCache& state, GLuint program, const VertexArray& vertexArray)
+{
+    state.UseProgram(program);
+    state.BindVertexArray(vertexArray.Name());
+    state.BindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, camera.Name());
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectBuffer.Name());
+}
+
+void GpuScene::Draw(ComputeScheduler& scheduler, GLStateCache& state, GLuint program, const VertexArray& vertexArray)
+{
+    if (objects.empty())
+        return;
+
+    scheduler.Consume({
+        { commands.Name(), ResourceUsage::Indirect, ResourceAccess::Read },
+        { drawCount.Name(), ResourceUsage::Indirect, ResourceAccess::Read } });
+    BindSceneBuffers(state, program, vertexArray);
+    state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.Name());
+    if (indirectCount)
+    {
+        state.BindBuffer(GL_PARAMETER_BUFFER, drawCount.Name());
+        indirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, (GLsizei)objects.size(), 0);
+    }
+    else
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)objects.size(), 0);
+}
+
+void GpuScene::DrawPerObject(GLStateCache& state, GLuint program, const VertexArray& vertexArray)
+{
+    UploadObjects();
+    camera.SetData(0, sizeof(CameraBlock), &cameraBlock);
+    BindSceneBuffers(state, program, vertexArray);
+
+    visibleLastDraw = 0;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        if (!Visible(objects[i]))
+            continue;
+        const MeshRecord& mesh = meshes[objects[i].mesh];
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT,
+            (const void*)(mesh.firstIndex * sizeof(GLuint)), 1, mesh.baseVertex, (GLuint)i);
+        visibleLastDraw++;
+    }
+}
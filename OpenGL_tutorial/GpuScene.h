@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ComputePass.h"
+#include "GLResources.h"
+
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+
+// GPU-driven scene: every mesh lives in one shared vertex buffer and one shared index buffer,
+// every object is a record in a storage buffer, and a compute pass culls the objects against
+// the camera frustum and writes the DrawElementsIndirectCommand array itself. A pass is then
+// one glMultiDrawElementsIndirectCount call, whatever the object count, and the CPU cost of
+// drawing no longer grows with the scene.
+// Without GL 4.6 / ARB_indirect_parameters the cull pass writes one command per object, with
+// instanceCount 0 for culled ones, and the draw is a plain glMultiDrawElementsIndirect.
+// Vertices are positions only (vec3); the object index reaches the vertex shader through an
+// instanced attribute and the command's baseInstance, so no ARB_shader_draw_parameters is needed.
+class GpuScene
+{
+public:
+    // shaders/gpu_cull.comp and shaders/gpu_scene.vert bind these
+    static const GLuint OBJECT_BINDING = 0;  // SSBO
+    static const GLuint MESH_BINDING = 1;    // SSBO
+    static const GLuint COMMAND_BINDING = 2; // SSBO
+    static const GLuint COUNT_BINDING = 3;   // SSBO
+    static const GLuint CAMERA_BINDING = 1;  // UBO, 0 is the render queue's per-draw block
+
+    bool Create(GLsizei vertexCapacity, GLsizei indexCapacity, GLsizei meshCapacity, GLsizei objectCapacity);
+    void Destroy();
+
+    // Returns the mesh index, or -1 when the shared buffers are full.
+    int AddMesh(const float* positions, GLsizei meshVertices, const GLuint* meshIndices, GLsizei meshIndexCount);
+    // Returns the object index, or -1 when the object buffer is full.
+    int AddObject(int mesh, const float position[3], float scale);
+
+    // Vertex arrays are per context; the caller owns one for every context that draws the scene.
+    void SetupVertexArray(VertexArray& vertexArray) const;
+
+    // `viewProjection` is column-major, as glUniformMatrix4fv expects.
+    void SetCamera(const float viewProjection[16]);
+    // Culls on the GPU and writes this frame's draw commands.
+    void Cull(ComputeScheduler& scheduler, GLuint cullProgram);
+    // Draws every visible object with one multi-draw.
+    void Draw(ComputeScheduler& scheduler, GLStateCache& state, GLuint program, const VertexArray& vertexArray);
+    // Culls on the CPU and issues one draw per visible object, for comparison.
+    void DrawPerObject(GLStateCache& state, GLuint program, const VertexArray& vertexArray);
+
+    bool IndirectCountSupported() const { return indirectCount != nullptr; }
+    GLsizei ObjectCount() const { return (GLsizei)objects.size(); }
+    // draws issued by the last DrawPerObject
+    GLsizei VisibleLastDraw() const { return visibleLastDraw; }
+
+private:
+    // std430 layouts shared with the shaders
+    struct MeshRecord
+    {
+        GLuint indexCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        float radius;
+    };
+
+    struct ObjectRecord
+    {
+        float positionScale[4];
+        GLuint mesh;
+        GLuint padding[3];
+    };
+
+    // std140
+    struct CameraBlock
+    {
+        float viewProjection[16];
+        float frustum[6][4];
+        GLuint objectCount;
+        GLuint compact;
+        GLuint padding[2];
+    };
+
+    void UploadObjects();
+    bool Visible(const ObjectRecord& object) const;
+    void BindSceneBuffers(GLStateCache& state, GLuint program, const VertexArray& vertexArray);
+
+    Buffer vertices;
+    Buffer indices;
+    Buffer meshBuffer;
+    Buffer objectBuffer;
+    Buffer objectIds; // 0..maxObjects-1, fetched per instance
+    Buffer commands;
+    Buffer drawCount;
+    Buffer camera;
+
+    // CPU copies for the per-object path
+    std::vector<MeshRecord> meshes;
+    std::vector<ObjectRecord> objects;
+    size_t uploadedObjects = 0;
+    CameraBlock cameraBlock = {};
+
+    GLsizei maxVertices = 0;
+    GLsizei maxIndices = 0;
+    GLsizei maxMeshes = 0;
+    GLsizei maxObjects = 0;
+    GLsizei vertexCount = 0;
+    GLsizei indexCount = 0;
+    GLsizei visibleLastDraw = 0;
+    PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC indirectCount = nullptr;
+};
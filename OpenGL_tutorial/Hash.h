@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a. Stable across runs and platforms, so it can key on-disk caches, and constexpr,
+// so string literals can be hashed at compile time.
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+constexpr uint64_t Fnv1a(const char* data, size_t length, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t)data[i]) * FNV_PRIME;
+    return hash;
+}
+
+inline uint64_t Fnv1a(const std::string& data, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    for (char c : data)
+        hash = (hash ^ (uint8_t)c) * FNV_PRIME;
+    return hash;
+}
+
+// Feeds a separator so ("ab", "c") and ("a", "bc") hash differently.
+inline uint64_t HashCombine(uint64_t hash, const std::string& data)
+{
+    hash = Fnv1a(data, hash);
+    return (hash ^ 0xff) * FNV_PRIME;
+}
+
+// Compile-time hash of a literal: "uModel"_hash
+constexpr uint64_t operator"" _hash(const char* data, size_t length)
+{
+    return Fnv1a(data, length);
+}
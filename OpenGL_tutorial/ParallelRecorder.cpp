@@ -0,0 +1,122 @@
+#include "ParallelRecorder.h"
+
+#include <algorithm>
+
+ParallelRecorder::~ParallelRecorder()
+{
+    Stop();
+}
+
+void ParallelRecorder::Start(unsigned int workers)
+{
+    Stop();
+    stopping = false;
+    lists = std::vector<ThreadList>(workers + 1);
+    for (unsigned int i = 1; i <= workers; ++i)
+        threads.emplace_back(&ParallelRecorder::WorkerLoop, this, i, generation);
+}
+
+void ParallelRecorder::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+    threads.clear();
+}
+
+void ParallelRecorder::Record(size_t count, size_t chunkSize, const RecordFunction& record)
+{
+    if (lists.empty())
+        lists.resize(1);
+    for (ThreadList& list : lists)
+    {
+        list.commands.Clear();
+        list.spans.clear();
+    }
+
+    job = &record;
+    itemCount = count;
+    itemsPerChunk = std::max<size_t>(chunkSize, 1);
+    chunkCount = (count + itemsPerChunk - 1) / itemsPerChunk;
+    nextChunk.store(0, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = (unsigned int)threads.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    RecordChunks(lists[0]);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void ParallelRecorder::RecordChunks(ThreadList& list)
+{
+    for (;;)
+    {
+        size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= chunkCount)
+            return;
+        size_t begin = chunk * itemsPerChunk;
+        size_t end = std::min(begin + itemsPerChunk, itemCount);
+
+        size_t first = list.commands.Size();
+        (*job)(list.commands, begin, end);
+        list.spans.push_back({ chunk, first, list.commands.Size() });
+    }
+}
+
+void ParallelRecorder::WorkerLoop(unsigned int index, unsigned long long seen)
+{
+    // `seen` is the generation at Start, a Record issued before this thread runs is not missed
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        RecordChunks(lists[index]);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last = --busy == 0;
+        }
+        if (last)
+            done.notify_one();
+    }
+}
+
+void ParallelRecorder::MergeInto(RenderQueue& queue) const
+{
+    // chunk index -> where it was recorded
+    std::vector<std::pair<const CommandList*, Span>> chunks(chunkCount);
+    size_t total = 0;
+    for (const ThreadList& list : lists)
+    {
+        for (const Span& span : list.spans)
+        {
+            chunks[span.chunk] = { &list.commands, span };
+            total += span.end - span.begin;
+        }
+    }
+
+    queue.Reserve(queue.Size() + total);
+    for (const auto& chunk : chunks)
+    {
+        if (chunk.first)
+            queue.Append(chunk.first->Data() + chunk.second.begin, chunk.second.end - chunk.second.begin);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "RenderQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Draw commands recorded by one thread. Storage is kept between frames, so after the first
+// frames recording only writes into memory the list already owns.
+class CommandList
+{
+public:
+    void Submit(const DrawCommand& command) { commands.push_back(command); }
+    void Submit(RenderPass pass, float depth, DrawCommand command)
+    {
+        command.key = RenderQueue::MakeKey(pass, command.program, command.material, command.vertexArray, depth);
+        commands.push_back(command);
+    }
+
+    void Clear() { commands.clear(); }
+    size_t Size() const { return commands.size(); }
+    const DrawCommand* Data() const { return commands.data(); }
+
+private:
+    std::vector<DrawCommand> commands;
+};
+
+// Scene traversal and draw preparation spread over worker threads. Only the thread that owns
+// the GL context may call GL (see SetActiveWindow), so workers only record: each one appends
+// into its own CommandList, and the GL thread merges the lists into a RenderQueue and executes it.
+// Work is handed out in fixed-size chunks of the item range; the merge concatenates chunks in
+// range order, so the queue's contents do not depend on which thread recorded what.
+class ParallelRecorder
+{
+public:
+    // Records items [begin, end) into `list`. Runs on any thread, must not call GL.
+    typedef std::function<void(CommandList& list, size_t begin, size_t end)> RecordFunction;
+
+    ~ParallelRecorder();
+
+    // `workers` threads in addition to the calling thread, which records too.
+    void Start(unsigned int workers);
+    void Stop();
+
+    // Returns once every item has been recorded.
+    void Record(size_t count, size_t chunkSize, const RecordFunction& record);
+    void MergeInto(RenderQueue& queue) const;
+
+    unsigned int Threads() const { return (unsigned int)lists.size(); }
+
+private:
+    struct Span
+    {
+        size_t chunk;
+        size_t begin;
+        size_t end;
+    };
+
+    // one per thread, padded so threads never write to the same cache line
+    struct alignas(64) ThreadList
+    {
+        CommandList commands;
+        std::vector<Span> spans;
+    };
+
+    void WorkerLoop(unsigned int index, unsigned long long seen);
+    void RecordChunks(ThreadList& list);
+
+    std::vector<std::thread> threads;
+    std::vector<ThreadList> lists; // [0] belongs to the calling thread
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned long long generation = 0;
+    unsigned int busy = 0;
+    bool stopping = false;
+
+    // current job
+    const RecordFunction* job = nullptr;
+    size_t itemCount = 0;
+    size_t itemsPerChunk = 1;
+    size_t chunkCount = 0;
+    std::atomic<size_t> nextChunk{ 0 };
+};
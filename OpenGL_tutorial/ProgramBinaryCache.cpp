@@ -0,0 +1,180 @@
+#include "ProgramBinaryCache.h"
+#include "Hash.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    const uint32_t BINARY_MAGIC = 0x42505247; // "GRPB"
+
+    struct BinaryHeader
+    {
+        uint32_t magic;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    std::string GLString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? (const char*)value : "";
+    }
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+    : directory(directory)
+{
+}
+
+bool ProgramBinaryCache::Init()
+{
+    driverIdentity = GLString(GL_VENDOR) + "|" + GLString(GL_RENDERER) + "|" + GLString(GL_VERSION);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    enabled = formats > 0;
+    if (!enabled)
+    {
+        std::cout << "Program binaries not supported by the driver, shader cache disabled" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    return true;
+}
+
+uint64_t ProgramBinaryCache::Key(const ProgramSource& source) const
+{
+    uint64_t hash = HashCombine(FNV_OFFSET_BASIS, driverIdentity);
+    hash = HashCombine(hash, source.vertex);
+    hash = HashCombine(hash, source.fragment);
+    hash = HashCombine(hash, source.compute);
+    for (const std::string& define : source.defines)
+        hash = HashCombine(hash, define);
+    return hash;
+}
+
+std::string ProgramBinaryCache::PathFor(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory + "/" + name;
+}
+
+GLuint ProgramBinaryCache::GetOrBuild(const ProgramSource& source)
+{
+    GLuint program = Load(source);
+    if (program != 0)
+        return program;
+
+    program = BuildProgram(source, enabled);
+    if (program != 0)
+        Store(source, program);
+    return program;
+}
+
+GLuint ProgramBinaryCache::Load(const ProgramSource& source)
+{
+    if (!enabled)
+    {
+        misses++;
+        return 0;
+    }
+
+    GLuint program = LoadBinary(source);
+    if (program != 0)
+        hits++;
+    else
+        misses++;
+    return program;
+}
+
+GLuint ProgramBinaryCache::LoadBinary(const ProgramSource& source)
+{
+    std::string path = PathFor(Key(source));
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(path, error);
+    if (error)
+        return 0;
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+        return 0;
+
+    // a truncated or corrupted entry must not size the allocation
+    BinaryHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || header.magic != BINARY_MAGIC
+        || header.length == 0 || header.length != fileSize - sizeof(header))
+    {
+        file.close();
+        std::remove(path.c_str());
+        rejected++;
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+        return 0;
+    file.close();
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // the driver may reject binaries after an update even with an identical identity string
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        rejected++;
+        return 0;
+    }
+    return program;
+}
+
+void ProgramBinaryCache::Store(const ProgramSource& source, GLuint program)
+{
+    if (!enabled)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+    // written next to the entry and renamed over it, so a crash or a concurrent reader never
+    // sees a partial file
+    BinaryHeader header = { BINARY_MAGIC, format, (uint32_t)length };
+    std::string path = PathFor(Key(source));
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (file)
+        {
+            file.write((const char*)&header, sizeof(header));
+            file.write(binary.data(), binary.size());
+        }
+        if (!file)
+        {
+            std::cout << "Failed to write program binary for " << source.name << std::endl;
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::cout << "Failed to write program binary for " << source.name << ": " << error.message() << std::endl;
+        std::remove(temporary.c_str());
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries.
+// Entries are keyed by a hash of the program's sources, its defines and the driver identity
+// (vendor, renderer, version), so a driver update invalidates every entry. A binary the driver
+// rejects is deleted and the program is compiled from source again.
+class ProgramBinaryCache
+{
+public:
+    explicit ProgramBinaryCache(const std::string& directory);
+
+    // Reads the driver identity; needs a current context. Returns false when the driver
+    // supports no binary formats, in which case every request compiles from source.
+    bool Init();
+
+    uint64_t Key(const ProgramSource& source) const;
+
+    // Restores the program from disk, or compiles it and stores its binary.
+    GLuint GetOrBuild(const ProgramSource& source);
+    GLuint Load(const ProgramSource& source);
+    void Store(const ProgramSource& source, GLuint program);
+
+    unsigned int Hits() const { return hits; }
+    unsigned int Misses() const { return misses; }
+    unsigned int Rejected() const { return rejected; }
+
+private:
+    std::string PathFor(uint64_t key) const;
+    GLuint LoadBinary(const ProgramSource& source);
+
+    std::string directory;
+    std::string driverIdentity;
+    bool enabled = false;
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int rejected = 0;
+};
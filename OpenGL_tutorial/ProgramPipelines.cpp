@@ -0,0 +1,90 @@
+#include "ProgramPipelines.h"
+#include "Hash.h"
+
+#include <iostream>
+
+GLuint BuildSeparableStage(GLenum type, const std::string& source, const std::string& name)
+{
+    // glCreateShaderProgramv compiles, sets GL_PROGRAM_SEPARABLE and links in one call
+    const char* code = source.c_str();
+    GLuint program = glCreateShaderProgramv(type, 1, &code);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(length > 0 ? length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+        std::cout << "ERROR::SEPARABLE_PROGRAM_ERROR in " << name << "\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+ProgramPipelines::~ProgramPipelines()
+{
+    // pipelines of other contexts die with their context
+    ReleaseContext();
+    for (auto& stage : stages)
+        glDeleteProgram(stage.second);
+}
+
+GLuint ProgramPipelines::Stage(GLenum type, const std::string& source, const std::string& name)
+{
+    uint64_t key = HashCombine(Fnv1a(std::to_string(type)), source);
+    auto found = stages.find(key);
+    if (found != stages.end())
+        return found->second;
+
+    GLuint program = BuildSeparableStage(type, source, name);
+    stageCompiles++;
+    if (program != 0)
+        stages[key] = program;
+    return program;
+}
+
+GLuint ProgramPipelines::Pipeline(GLuint vertexStage, GLuint fragmentStage)
+{
+    PipelineKey key(glfwGetCurrentContext(), vertexStage, fragmentStage);
+    auto found = pipelines.find(key);
+    if (found != pipelines.end())
+        return found->second;
+
+    GLuint pipeline;
+    glGenProgramPipelines(1, &pipeline);
+    glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertexStage);
+    glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragmentStage);
+
+    glValidateProgramPipeline(pipeline);
+    GLint valid = GL_FALSE;
+    glGetProgramPipelineiv(pipeline, GL_VALIDATE_STATUS, &valid);
+    if (!valid)
+    {
+        GLint length = 0;
+        glGetProgramPipelineiv(pipeline, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(length > 0 ? length : 1, '\0');
+        glGetProgramPipelineInfoLog(pipeline, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+        std::cout << "ERROR::PROGRAM_PIPELINE_VALIDATION_ERROR\n" << infoLog << std::endl;
+    }
+
+    pipelines[key] = pipeline;
+    return pipeline;
+}
+
+void ProgramPipelines::ReleaseContext()
+{
+    GLFWwindow* context = glfwGetCurrentContext();
+    for (auto it = pipelines.begin(); it != pipelines.end();)
+    {
+        if (std::get<0>(it->first) == context)
+        {
+            glDeleteProgramPipelines(1, &it->second);
+            it = pipelines.erase(it);
+        }
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+// Separable programs combined through program pipeline objects (ARB_separate_shader_objects).
+// Each stage is compiled and linked once as its own program; pairing M vertex stages with
+// N fragment stages then costs M + N compiles instead of M * N program links.
+// Stage programs are shared between contexts. Pipelines are container objects, which GL does
+// not share, so they are cached per context (the one current when Pipeline() is called).
+// Vertex stages used this way must redeclare `out gl_PerVertex { vec4 gl_Position; };`.
+class ProgramPipelines
+{
+public:
+    ~ProgramPipelines();
+    ProgramPipelines() = default;
+    ProgramPipelines(const ProgramPipelines&) = delete;
+    ProgramPipelines& operator=(const ProgramPipelines&) = delete;
+
+    // Returns the separable program for this stage source, compiling it on first use.
+    GLuint Stage(GLenum type, const std::string& source, const std::string& name);
+    // Returns the current context's pipeline combining the two stages.
+    GLuint Pipeline(GLuint vertexStage, GLuint fragmentStage);
+
+    // Deletes the pipelines of the current context; call before destroying it.
+    void ReleaseContext();
+
+    unsigned int StageCompiles() const { return stageCompiles; }
+    size_t PipelineCount() const { return pipelines.size(); }
+
+private:
+    typedef std::tuple<GLFWwindow*, GLuint, GLuint> PipelineKey;
+
+    std::unordered_map<uint64_t, GLuint> stages;
+    std::map<PipelineKey, GLuint> pipelines;
+    unsigned int stageCompiles = 0;
+};
+
+// Compiles and links a single-stage separable program; 0 on failure.
+GLuint BuildSeparableStage(GLenum type, const std::string& source, const std::string& name);
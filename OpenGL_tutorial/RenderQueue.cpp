@@ -0,0 +1,247 @@
+#include "RenderQueue.h"
+
+#include "DynamicBufferRing.h"
+#include "GLResources.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace
+{
+    const int PASS_SHIFT = 60;
+    const int PROGRAM_SHIFT = 48;
+    const int MATERIAL_SHIFT = 32;
+    const int VERTEX_ARRAY_SHIFT = 20;
+    const uint64_t DEPTH_MAX = (1u << 20) - 1;
+
+    // everything a draw call depends on apart from the instance data
+    auto DrawParameters(const DrawCommand& command)
+    {
+        return std::make_tuple(command.program, command.vertexArray, command.material, command.mode, command.indexType,
+            command.count, command.first, command.baseVertex, command.uniformBuffer, command.uniformOffset, command.uniformSize);
+    }
+}
+
+void RenderQueue::SetupInstanceAttribute(VertexArray& vertexArray, const DynamicBufferRing& ring)
+{
+    vertexArray.SetVertexBuffer(INSTANCE_BINDING, ring.Buffer(), 0, INSTANCE_STRIDE, 1);
+    vertexArray.SetAttribute(INSTANCE_ATTRIBUTE, INSTANCE_BINDING, 4, GL_FLOAT, GL_FALSE, 0);
+}
+
+uint16_t RenderQueue::AddMaterial(const Material& material)
+{
+    materials.push_back(material);
+    return (uint16_t)(materials.size() - 1);
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, GLuint program, uint16_t material, GLuint vertexArray, float depth)
+{
+    depth = std::min(std::max(depth, 0.0f), 1.0f);
+    uint64_t quantized = (uint64_t)(depth * DEPTH_MAX);
+    if (pass == RenderPass::Transparent)
+        quantized = DEPTH_MAX - quantized;
+
+    return ((uint64_t)pass << PASS_SHIFT)
+        | ((uint64_t)(program & 0xFFF) << PROGRAM_SHIFT)
+        | ((uint64_t)material << MATERIAL_SHIFT)
+        | ((uint64_t)(vertexArray & 0xFFF) << VERTEX_ARRAY_SHIFT)
+        | quantized;
+}
+
+void RenderQueue::Submit(const DrawCommand& command)
+{
+    commands.push_back(command);
+}
+
+void RenderQueue::Submit(RenderPass pass, float depth, DrawCommand command)
+{
+    command.key = MakeKey(pass, command.program, command.material, command.vertexArray, depth);
+    commands.push_back(command);
+}
+
+void RenderQueue::Sort()
+{
+    const size_t count = commands.size();
+    items.resize(count);
+    scratch.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        items[i] = { commands[i].key, (uint32_t)i };
+
+    // LSD radix sort, 8 bits per pass; all histograms are built in one read of the keys
+    size_t histograms[8][256] = {};
+    for (const SortItem& item : items)
+    {
+        for (int digit = 0; digit < 8; ++digit)
+            histograms[digit][(item.key >> (digit * 8)) & 0xFF]++;
+    }
+
+    for (int digit = 0; digit < 8; ++digit)
+    {
+        size_t* histogram = histograms[digit];
+        // every key has the same byte here, the pass would not move anything
+        if (count == 0 || histogram[(items[0].key >> (digit * 8)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            size_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+        for (const SortItem& item : items)
+            scratch[histogram[(item.key >> (digit * 8)) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+
+    order.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        order[i] = items[i].index;
+    batchedValid = false;
+}
+
+bool RenderQueue::Batch(DynamicBufferRing& ring, bool merge)
+{
+    batched.clear();
+    batchedValid = true;
+
+    size_t instances = 0;
+    for (const DrawCommand& command : commands)
+        instances += command.instanced;
+    DynamicBufferRing::Allocation allocation;
+    if (instances > 0)
+        allocation = ring.Allocate(instances * INSTANCE_STRIDE, INSTANCE_STRIDE);
+    bool fits = instances == 0 || allocation.cpu != nullptr;
+    float* instanceData = (float*)allocation.cpu;
+    GLuint nextInstance = (GLuint)(allocation.offset / INSTANCE_STRIDE);
+
+    // non-instanced commands first, then instanced ones grouped by mesh
+    auto mergeOrder = [this](uint32_t a, uint32_t b) {
+        const DrawCommand& left = commands[a];
+        const DrawCommand& right = commands[b];
+        if (left.instanced != right.instanced)
+            return !left.instanced;
+        return left.instanced && DrawParameters(left) < DrawParameters(right);
+    };
+
+    size_t i = 0;
+    while (i < order.size())
+    {
+        // commands with the same key apart from depth
+        uint64_t stateKey = commands[order[i]].key >> VERTEX_ARRAY_SHIFT;
+        size_t end = i + 1;
+        while (end < order.size() && commands[order[end]].key >> VERTEX_ARRAY_SHIFT == stateKey)
+            ++end;
+
+        RenderPass pass = (RenderPass)(stateKey >> (PASS_SHIFT - VERTEX_ARRAY_SHIFT));
+        if (merge && fits && (pass == RenderPass::Shadow || pass == RenderPass::Opaque))
+            std::stable_sort(order.begin() + i, order.begin() + end, mergeOrder);
+
+        while (i < end)
+        {
+            DrawCommand draw = commands[order[i]];
+            if (!draw.instanced)
+            {
+                batched.push_back(draw);
+                ++i;
+                continue;
+            }
+            if (!fits)
+            {
+                ++i;
+                continue;
+            }
+
+            draw.instanced = false;
+            draw.instanceCount = 0;
+            draw.baseInstance = nextInstance;
+            do
+            {
+                memcpy(instanceData, commands[order[i]].instance, INSTANCE_STRIDE);
+                instanceData += 4;
+                nextInstance++;
+                draw.instanceCount++;
+                ++i;
+            } while (merge && i < end && commands[order[i]].instanced && DrawParameters(commands[order[i]]) == DrawParameters(draw));
+            batched.push_back(draw);
+        }
+    }
+    return fits;
+}
+
+void RenderQueue::ApplyMaterial(GLStateCache& state, const Material& material)
+{
+    bool dsa = UsingDirectStateAccess();
+    for (GLuint unit = 0; unit < 4; ++unit)
+    {
+        if (material.textures[unit] == 0)
+            continue;
+        if (dsa)
+            state.BindTextureUnit(unit, material.textures[unit]);
+        else
+            state.BindTexture(unit, GL_TEXTURE_2D, material.textures[unit]);
+    }
+
+    state.SetEnabled(GL_BLEND, material.blend);
+    if (material.blend)
+        state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state.SetEnabled(GL_DEPTH_TEST, material.depthTest);
+    state.DepthMask(material.depthWrite);
+    state.SetEnabled(GL_CULL_FACE, material.cullBackFaces);
+    if (material.cullBackFaces)
+        state.CullFace(GL_BACK);
+}
+
+void RenderQueue::Draw(GLStateCache& state, const DrawCommand& command, uint32_t& currentMaterial)
+{
+    state.UseProgram(command.program);
+    state.BindVertexArray(command.vertexArray);
+    if (command.material != currentMaterial && command.material < materials.size())
+    {
+        ApplyMaterial(state, materials[command.material]);
+        currentMaterial = command.material;
+        materialChanges++;
+    }
+    if (command.uniformBuffer != 0)
+    {
+        state.BindBufferRange(GL_UNIFORM_BUFFER, PER_DRAW_UNIFORM_BINDING,
+            command.uniformBuffer, command.uniformOffset, command.uniformSize);
+    }
+
+    if (command.indexType == 0)
+    {
+        glDrawArraysInstancedBaseInstance(command.mode, (GLint)command.first, command.count,
+            command.instanceCount, command.baseInstance);
+    }
+    else
+    {
+        glDrawElementsInstancedBaseVertexBaseInstance(command.mode, command.count, command.indexType,
+            (const void*)command.first, command.instanceCount, command.baseVertex, command.baseInstance);
+    }
+    draws++;
+}
+
+void RenderQueue::Execute(GLStateCache& state)
+{
+    materialChanges = 0;
+    draws = 0;
+    uint32_t currentMaterial = 0xFFFFFFFF;
+    if (batchedValid)
+    {
+        for (const DrawCommand& command : batched)
+            Draw(state, command, currentMaterial);
+        return;
+    }
+    for (uint32_t index : order)
+        Draw(state, commands[index], currentMaterial);
+}
+
+void RenderQueue::Clear()
+{
+    commands.clear();
+    order.clear();
+    batched.clear();
+    batchedValid = false;
+}
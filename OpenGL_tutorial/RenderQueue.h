@@ -0,0 +1,122 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DynamicBufferRing;
+class GLStateCache;
+class VertexArray;
+
+enum class RenderPass : uint8_t
+{
+    Shadow,
+    Opaque,
+    Transparent, // sorted back to front
+    Overlay,
+};
+
+struct Material
+{
+    GLuint textures[4] = {}; // GL_TEXTURE_2D, bound to units 0-3
+    bool blend = false;      // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+    bool depthTest = true;
+    bool depthWrite = true;
+    bool cullBackFaces = true;
+};
+
+// One draw, plain data so recording is a copy. indexType 0 draws arrays.
+struct DrawCommand
+{
+    uint64_t key = 0;
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    uint16_t material = 0;
+    GLenum mode = GL_TRIANGLES;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLsizei count = 0;
+    GLintptr first = 0;      // byte offset into the element buffer, or first vertex
+    GLint baseVertex = 0;
+    GLsizei instanceCount = 1;
+    GLuint baseInstance = 0;
+    // one instance whose data is `instance`; Batch streams the data and merges identical draws
+    bool instanced = false;
+    float instance[4] = {};
+    // optional per-draw uniform block, bound to PER_DRAW_UNIFORM_BINDING
+    GLuint uniformBuffer = 0;
+    GLintptr uniformOffset = 0;
+    GLsizeiptr uniformSize = 0;
+};
+
+// Draws are recorded during scene traversal without touching GL, sorted once by a 64-bit key,
+// then executed in one loop through the state cache.
+// Key layout, most significant first: pass (4 bits) | program (12) | material (16) |
+// vertex array (12) | depth (20). Sorting by key groups draws by the state that is most
+// expensive to change; depth orders opaque draws front to back and transparent ones back to
+// front. Program and vertex array names are truncated into the key, a collision only costs a
+// state change because the command carries the full names.
+// Instanced commands are merged after sorting: draws of the same mesh with the same state become
+// one glDrawElementsInstancedBaseVertexBaseInstance, their per-instance data packed into the
+// frame's DynamicBufferRing and fetched through baseInstance. Shadow and opaque draws are merged
+// across the whole state group; transparent and overlay draws only when adjacent, so their
+// order is kept.
+class RenderQueue
+{
+public:
+    static const GLuint PER_DRAW_UNIFORM_BINDING = 0;
+    // vec4 per instance, read from the DynamicBufferRing
+    static const GLuint INSTANCE_ATTRIBUTE = 4;
+    static const GLuint INSTANCE_BINDING = 4;
+    static const GLsizei INSTANCE_STRIDE = 4 * sizeof(float);
+
+    // Points the instance attribute of `vertexArray` at the ring; needed once per vertex array.
+    static void SetupInstanceAttribute(VertexArray& vertexArray, const DynamicBufferRing& ring);
+
+    uint16_t AddMaterial(const Material& material);
+    const Material& GetMaterial(uint16_t index) const { return materials[index]; }
+
+    // `depth` is the view depth normalised to [0, 1].
+    static uint64_t MakeKey(RenderPass pass, GLuint program, uint16_t material, GLuint vertexArray, float depth);
+
+    void Submit(const DrawCommand& command);
+    void Submit(RenderPass pass, float depth, DrawCommand command);
+    void Append(const DrawCommand* first, size_t count) { commands.insert(commands.end(), first, first + count); }
+    void Reserve(size_t count) { commands.reserve(count); }
+    // Radix sort by key; call once after the last Submit of the frame.
+    void Sort();
+    // Call after Sort when instanced commands were submitted. `merge` false still streams the
+    // instance data but keeps one draw per command (for comparison). Returns false when the
+    // ring has no room for this frame's instances; the instanced draws are then skipped.
+    bool Batch(DynamicBufferRing& ring, bool merge = true);
+    void Execute(GLStateCache& state);
+    void Clear();
+
+    size_t Size() const { return commands.size(); }
+    const std::vector<DrawCommand>& Commands() const { return commands; }
+    // command indices in execution order, valid after Sort
+    const std::vector<uint32_t>& Order() const { return order; }
+    unsigned int MaterialChangesLastExecute() const { return materialChanges; }
+    unsigned int DrawsLastExecute() const { return draws; }
+
+private:
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    void ApplyMaterial(GLStateCache& state, const Material& material);
+    void Draw(GLStateCache& state, const DrawCommand& command, uint32_t& currentMaterial);
+
+    std::vector<Material> materials;
+    std::vector<DrawCommand> commands;
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+    std::vector<uint32_t> order;
+    std::vector<DrawCommand> batched; // execution list after Batch
+    bool batchedValid = false;
+    unsigned int materialChanges = 0;
+    unsigned int draws = 0;
+};
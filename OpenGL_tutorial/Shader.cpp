@@ -0,0 +1,128 @@
+#include "Shader.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::string ReadShaderFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return std::string();
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+ProgramSource LoadProgramSource(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath)
+{
+    ProgramSource source;
+    source.name = name;
+    source.vertex = ReadShaderFile(vertexPath);
+    source.fragment = ReadShaderFile(fragmentPath);
+    return source;
+}
+
+std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines)
+{
+    if (defines.empty())
+        return source;
+
+    std::string block;
+    for (const std::string& define : defines)
+        block += "#define " + define + "\n";
+
+    // #version has to stay the first statement
+    size_t insertAt = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos)
+    {
+        size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    std::string result = source.substr(0, insertAt);
+    if (!result.empty() && result.back() != '\n')
+        result += '\n';
+    return result + block + source.substr(insertAt);
+}
+
+GLuint CompileShader(GLenum type, const std::string& source, const std::string& name)
+{
+    GLuint shader = glCreateShader(type);
+    const char* code = source.c_str();
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(length > 0 ? length : 1, '\0');
+        glGetShaderInfoLog(shader, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+        std::cout << "ERROR::SHADER_COMPILATION_ERROR in " << name << "\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint LinkProgram(const std::vector<GLuint>& shaders, const std::string& name, bool retrievable)
+{
+    GLuint program = glCreateProgram();
+    if (retrievable)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (GLuint shader : shaders)
+        glAttachShader(program, shader);
+    glLinkProgram(program);
+    for (GLuint shader : shaders)
+        glDetachShader(program, shader);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(length > 0 ? length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+        std::cout << "ERROR::PROGRAM_LINKING_ERROR in " << name << "\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint BuildProgram(const ProgramSource& source, bool retrievable)
+{
+    struct Stage { GLenum type; const std::string* code; };
+    const Stage stages[] = {
+        { GL_VERTEX_SHADER, &source.vertex },
+        { GL_FRAGMENT_SHADER, &source.fragment },
+        { GL_COMPUTE_SHADER, &source.compute },
+    };
+
+    std::vector<GLuint> shaders;
+    bool ok = true;
+    for (const Stage& stage : stages)
+    {
+        if (stage.code->empty())
+            continue;
+        GLuint shader = CompileShader(stage.type, InjectDefines(*stage.code, source.defines), source.name);
+        if (shader == 0)
+        {
+            ok = false;
+            break;
+        }
+        shaders.push_back(shader);
+    }
+
+    GLuint program = ok ? LinkProgram(shaders, source.name, retrievable) : 0;
+    for (GLuint shader : shaders)
+        glDeleteShader(shader);
+    return program;
+}
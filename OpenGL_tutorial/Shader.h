@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// GLSL sources of one program. Empty stages are skipped; defines are "NAME" or "NAME VALUE"
+// and are injected right after the #version line.
+struct ProgramSource
+{
+    std::string name;
+    std::string vertex;
+    std::string fragment;
+    std::string compute;
+    std::vector<std::string> defines;
+};
+
+// Files a program is built from, relative to a shader directory.
+struct ShaderFiles
+{
+    std::string name;
+    std::string vertex;
+    std::string fragment;
+    std::string compute;
+    std::vector<std::string> defines;
+};
+
+std::string ReadShaderFile(const std::string& path);
+ProgramSource LoadProgramSource(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath);
+
+std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines);
+
+// Compile/link helpers print the info log and return 0 on failure.
+GLuint CompileShader(GLenum type, const std::string& source, const std::string& name);
+// `retrievable` sets GL_PROGRAM_BINARY_RETRIEVABLE_HINT so glGetProgramBinary can be used.
+GLuint LinkProgram(const std::vector<GLuint>& shaders, const std::string& name, bool retrievable);
+GLuint BuildProgram(const ProgramSource& source, bool retrievable = false);
@@ -0,0 +1,229 @@
+#include "ShaderHotReload.h"
+
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderHotReload::ShaderHotReload(const std::string& directory)
+    : directory(directory)
+{
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    Stop();
+}
+
+bool ShaderHotReload::Start()
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        std::cout << "Failed to initialise inotify, shader hot reload disabled" << std::endl;
+        return false;
+    }
+    if (!WatchTree(directory))
+    {
+        std::cout << "Failed to watch " << directory << ", shader hot reload disabled" << std::endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+
+    running = true;
+    watcher = std::thread(&ShaderHotReload::WatchLoop, this);
+    return true;
+#else
+    std::cout << "Shader hot reload is only available on Linux" << std::endl;
+    return false;
+#endif
+}
+
+bool ShaderHotReload::WatchTree(const std::string& path)
+{
+#ifdef __linux__
+    // editors either rewrite the file in place or write a temporary and rename it over;
+    // IN_CREATE only matters for directories, which get watched in turn
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+    int descriptor = inotify_add_watch(inotifyFd, path.c_str(), mask);
+    if (descriptor < 0)
+        return false;
+    watchedDirectories[descriptor] = std::filesystem::path(path).lexically_normal().generic_string();
+
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(path, error);
+        !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (!it->is_directory(error))
+            continue;
+        descriptor = inotify_add_watch(inotifyFd, it->path().c_str(), mask);
+        if (descriptor >= 0)
+            watchedDirectories[descriptor] = it->path().lexically_normal().generic_string();
+    }
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void ShaderHotReload::Stop()
+{
+#ifdef __linux__
+    if (!running)
+        return;
+    running = false;
+    watcher.join();
+    close(inotifyFd);
+    inotifyFd = -1;
+    watchedDirectories.clear();
+#endif
+}
+
+AsyncProgramHandle ShaderHotReload::Load(AsyncProgramBuilder& builder, const ShaderFiles& files, GLuint fallback)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Tracked tracked = { std::make_shared<AsyncProgram>(), files, {}, nullptr, nullptr };
+    tracked.handle->name = files.name;
+    tracked.handle->fallback = fallback;
+    ProgramSource source;
+    if (preprocessor.Expand(files, directory, source, &tracked.dependencies))
+    {
+        tracked.build = library.Acquire(builder, source);
+        // another program may have built the same text already
+        tracked.handle->program = tracked.build->program;
+        tracked.handle->ready = tracked.build->ready;
+    }
+    else
+    {
+        // keep watching, fixing the file will build it
+        tracked.handle->failed = true;
+    }
+    programs.push_back(tracked);
+    return tracked.handle;
+}
+
+void ShaderHotReload::OnFileChanged(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    preprocessor.Invalidate(path);
+
+    for (size_t index = 0; index < programs.size(); ++index)
+    {
+        Tracked& tracked = programs[index];
+        if (tracked.dependencies.count(path) == 0)
+            continue;
+
+        std::cout << "Reloading shader program " << tracked.files.name << " (" << path << " changed)" << std::endl;
+        // the edit may have added or removed includes
+        std::set<std::string> dependencies;
+        ProgramSource source;
+        if (preprocessor.Expand(tracked.files, directory, source, &dependencies))
+        {
+            tracked.dependencies = dependencies;
+            readySources.push_back({ index, std::move(source) });
+        }
+        else
+        {
+            // keep the old dependencies too, the fix may land in any of them
+            tracked.dependencies.insert(dependencies.begin(), dependencies.end());
+        }
+    }
+}
+
+void ShaderHotReload::WatchLoop()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    while (running)
+    {
+        pollfd descriptor = { inotifyFd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        // several events for the same file usually arrive together, handle each file once
+        std::set<std::string> changed;
+        std::vector<std::string> newDirectories;
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length;)
+            {
+                const inotify_event* event = (const inotify_event*)ptr;
+                auto watched = watchedDirectories.find(event->wd);
+                if (event->len > 0 && watched != watchedDirectories.end())
+                {
+                    std::string path = watched->second + "/" + event->name;
+                    if (event->mask & IN_ISDIR)
+                        newDirectories.push_back(path);
+                    else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                        changed.insert(path);
+                }
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        // files written into a new directory before its watch existed are missed; that only
+        // matters for files nothing has included yet
+        for (const std::string& path : newDirectories)
+            WatchTree(path);
+        for (const std::string& file : changed)
+            OnFileChanged(std::filesystem::path(file).lexically_normal().generic_string());
+    }
+#endif
+}
+
+void ShaderHotReload::Update(AsyncProgramBuilder& builder)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& ready : readySources)
+    {
+        Tracked& tracked = programs[ready.first];
+        // a newer edit supersedes a rebuild still in flight
+        if (tracked.rebuild)
+            library.Release(tracked.rebuild);
+        tracked.rebuild = library.Acquire(builder, ready.second);
+    }
+    readySources.clear();
+    library.Collect();
+
+    for (Tracked& tracked : programs)
+    {
+        // the first build, which may be shared with a program loaded earlier
+        if (tracked.build && !tracked.handle->ready && tracked.build->ready)
+        {
+            tracked.handle->program = tracked.build->program;
+            tracked.handle->ready = true;
+        }
+        else if (tracked.build && !tracked.handle->ready && tracked.build->failed)
+            tracked.handle->failed = true;
+
+        if (!tracked.rebuild)
+            continue;
+        if (tracked.rebuild->failed)
+        {
+            library.Release(tracked.rebuild);
+            tracked.rebuild = nullptr;
+            continue;
+        }
+        if (!tracked.rebuild->ready)
+            continue;
+
+        // frame boundary: nothing is drawing with the old program any more. The library
+        // deletes it once the last program sharing it has moved on.
+        if (tracked.build)
+            library.Release(tracked.build);
+        tracked.build = tracked.rebuild;
+        tracked.rebuild = nullptr;
+        tracked.handle->program = tracked.build->program;
+        tracked.handle->ready = true;
+        tracked.handle->failed = false;
+        reloads++;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "AsyncProgramBuilder.h"
+#include "ShaderLibrary.h"
+#include "ShaderPreprocessor.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rebuilds programs when their shader files change on disk (Linux, inotify). The shader directory
+// is watched recursively, directories created later included.
+// Each program remembers every file its last expansion read (stages and #includes, see
+// ShaderPreprocessor). A watcher thread receives the change events, finds the programs that
+// depend on a changed file and re-expands only those, refreshing their dependencies. The render thread
+// only submits those sources to the AsyncProgramBuilder and, in Update at the start of a frame,
+// swaps finished programs into their handles, so a frame never sees a half-replaced program.
+// Builds go through a ShaderLibrary: programs whose expansions are identical share one build,
+// both at load and when an edit touches all of them, and saving a file without a change that
+// survives preprocessing compiles nothing.
+// A program that fails to build keeps running with its previous version.
+class ShaderHotReload
+{
+public:
+    explicit ShaderHotReload(const std::string& directory);
+    ~ShaderHotReload();
+
+    bool Start();
+    void Stop();
+
+    // Expands the program's files, submits them to the builder and tracks the resulting handle.
+    // The handle is this program's own; Update points it at the shared build.
+    AsyncProgramHandle Load(AsyncProgramBuilder& builder, const ShaderFiles& files, GLuint fallback = 0);
+    // Call once per frame, before any drawing.
+    void Update(AsyncProgramBuilder& builder);
+
+    unsigned int Reloads() const { return reloads; }
+    // Load and reload requests, and the distinct programs they currently need.
+    unsigned int BuildRequests() const { return library.Requests(); }
+    size_t UniquePrograms() const { return library.UniquePrograms(); }
+
+private:
+    struct Tracked
+    {
+        AsyncProgramHandle handle;
+        ShaderFiles files;
+        std::set<std::string> dependencies;
+        AsyncProgramHandle build;   // shared with every program expanding to the same text
+        AsyncProgramHandle rebuild; // shared as well
+    };
+
+    void WatchLoop();
+    void OnFileChanged(const std::string& path);
+    // Watches `path` and every directory below it (included files may live in subdirectories).
+    bool WatchTree(const std::string& path);
+
+    std::string directory;
+    std::thread watcher;
+    std::atomic<bool> running{ false };
+    int inotifyFd = -1;
+    std::map<int, std::string> watchedDirectories; // inotify watch descriptor -> directory
+
+    std::mutex mutex; // guards everything below
+    ShaderPreprocessor preprocessor;
+    std::vector<Tracked> programs;
+    std::vector<std::pair<size_t, ProgramSource>> readySources;
+    ShaderLibrary library;
+
+    unsigned int reloads = 0;
+};
@@ -0,0 +1,57 @@
+#include "ShaderLibrary.h"
+#include "Hash.h"
+
+namespace
+{
+    uint64_t SourceHash(const ProgramSource& source)
+    {
+        uint64_t hash = HashCombine(FNV_OFFSET_BASIS, source.vertex);
+        hash = HashCombine(hash, source.fragment);
+        hash = HashCombine(hash, source.compute);
+        for (const std::string& define : source.defines)
+            hash = HashCombine(hash, define);
+        return hash;
+    }
+}
+
+AsyncProgramHandle ShaderLibrary::Acquire(AsyncProgramBuilder& builder, const ProgramSource& source)
+{
+    requests++;
+
+    Entry& entry = programs[SourceHash(source)];
+    // a failed build is retried, the same text may link once an unrelated driver issue is gone
+    if (!entry.handle || (entry.handle->failed && entry.references == 0))
+        entry.handle = builder.Submit(source);
+    entry.references++;
+    return entry.handle;
+}
+
+void ShaderLibrary::Release(const AsyncProgramHandle& handle)
+{
+    for (auto it = programs.begin(); it != programs.end(); ++it)
+    {
+        if (it->second.handle != handle)
+            continue;
+        if (--it->second.references > 0)
+            return;
+        released.push_back(handle);
+        programs.erase(it);
+        break;
+    }
+    Collect();
+}
+
+void ShaderLibrary::Collect()
+{
+    for (size_t i = 0; i < released.size();)
+    {
+        if (released[i]->ready || released[i]->failed)
+        {
+            if (released[i]->program != 0)
+                glDeleteProgram(released[i]->program);
+            released.erase(released.begin() + i);
+        }
+        else
+            ++i;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "AsyncProgramBuilder.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Owns programs, deduplicated by the content hash of their fully expanded sources (run
+// ShaderPreprocessor::Expand first). Two requests that expand to the same text (the same file
+// reached through different paths, or defines that end up not mattering once dead branches are
+// stripped) share one AsyncProgramBuilder build and are compiled exactly once.
+// Programs are reference counted: every Acquire takes a reference, Release drops it, and the
+// program is deleted once nothing references it and its build has finished. Programs still
+// referenced when the library goes away are left to the context.
+// Render thread only.
+class ShaderLibrary
+{
+public:
+    // The returned build is shared; never write into it.
+    AsyncProgramHandle Acquire(AsyncProgramBuilder& builder, const ProgramSource& source);
+    void Release(const AsyncProgramHandle& handle);
+    // Deletes released programs whose build has finished; call once per frame, before drawing.
+    void Collect();
+
+    unsigned int Requests() const { return requests; }
+    size_t UniquePrograms() const { return programs.size(); }
+
+private:
+    struct Entry
+    {
+        AsyncProgramHandle handle;
+        unsigned int references = 0;
+    };
+
+    std::unordered_map<uint64_t, Entry> programs;
+    std::vector<AsyncProgramHandle> released; // unreferenced, still building
+    unsigned int requests = 0;
+};
@@ -0,0 +1,175 @@
+#include "ShaderPermutations.h"
+#include "ProgramBinaryCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+    const char* const FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {
+        "USE_SKINNING",
+        "USE_NORMAL_MAP",
+        "USE_SHADOW",
+        "USE_INSTANCING",
+    };
+}
+
+std::vector<std::string> PermutationKey::Defines() const
+{
+    std::vector<std::string> defines;
+    for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; ++i)
+    {
+        if (bits & (1u << i))
+            defines.push_back(FEATURE_DEFINES[i]);
+    }
+    return defines;
+}
+
+ShaderPermutations::ShaderPermutations(const ProgramSource& base, ProgramBinaryCache* cache, const std::string& cacheDirectory, size_t capacity)
+    : base(base), cache(cache), seenPath(cacheDirectory + "/" + base.name + ".permutations"), capacity(capacity)
+{
+    std::ifstream file(seenPath);
+    uint32_t bits;
+    while (file >> std::hex >> bits)
+        seen.push_back(bits);
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    SaveSeen();
+    for (Entry& entry : lru)
+        glDeleteProgram(entry.program);
+    for (GLuint program : retired)
+        glDeleteProgram(program);
+}
+
+void ShaderPermutations::SaveSeen() const
+{
+    std::ofstream file(seenPath, std::ios::out | std::ios::trunc);
+    for (uint32_t bits : seen)
+        file << std::hex << bits << "\n";
+}
+
+ProgramSource ShaderPermutations::SourceFor(PermutationKey key) const
+{
+    ProgramSource source = base;
+    std::vector<std::string> defines = key.Defines();
+    source.defines.insert(source.defines.end(), defines.begin(), defines.end());
+    source.name = base.name + "#" + std::to_string(key.Bits());
+    return source;
+}
+
+void ShaderPermutations::PreWarm(AsyncProgramBuilder& asyncBuilder)
+{
+    builder = &asyncBuilder;
+    for (uint32_t bits : seen)
+    {
+        if (index.count(bits) == 0 && warming.count(bits) == 0)
+            warming[bits] = builder->Submit(SourceFor(PermutationKey(bits)));
+    }
+}
+
+void ShaderPermutations::BeginFrame()
+{
+    // the previous frame is fully submitted, nothing holds these names any more
+    for (GLuint program : retired)
+        glDeleteProgram(program);
+    retired.clear();
+
+    for (auto it = warming.begin(); it != warming.end();)
+    {
+        const AsyncProgram& warm = *it->second;
+        if (warm.ready)
+        {
+            Insert(PermutationKey(it->first), warm.program);
+            it = warming.erase(it);
+        }
+        else if (warm.failed)
+        {
+            failed.insert(it->first);
+            it = warming.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    stallsLastFrame = stallsThisFrame;
+    stallMsLastFrame = stallMsThisFrame;
+    stallsThisFrame = 0;
+    stallMsThisFrame = 0.0;
+}
+
+void ShaderPermutations::Insert(PermutationKey key, GLuint program)
+{
+    lru.push_front({ key, program });
+    index[key.Bits()] = lru.begin();
+
+    if (lru.size() > capacity)
+    {
+        // still in the binary cache, so bringing it back later is cheap
+        Entry& oldest = lru.back();
+        retired.push_back(oldest.program);
+        index.erase(oldest.key.Bits());
+        lru.pop_back();
+    }
+}
+
+GLuint ShaderPermutations::Get(PermutationKey key)
+{
+    auto found = index.find(key.Bits());
+    if (found != index.end())
+    {
+        lru.splice(lru.begin(), lru, found->second);
+        return found->second->program;
+    }
+    if (failed.count(key.Bits()))
+        return fallback;
+
+    auto start = std::chrono::steady_clock::now();
+    GLuint program = 0;
+    auto warm = warming.find(key.Bits());
+    if (warm != warming.end())
+    {
+        // already compiling in the background: finishing that build is cheaper than a second one
+        AsyncProgramHandle handle = warm->second;
+        warming.erase(warm);
+        if (builder->Wait(handle))
+            program = handle->program;
+    }
+    else
+    {
+        ProgramSource source = SourceFor(key);
+        program = cache ? cache->GetOrBuild(source) : BuildProgram(source);
+    }
+    stallsThisFrame++;
+    stallMsThisFrame += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (program == 0)
+    {
+        // the build printed its log; until the sources change it would only fail again
+        failed.insert(key.Bits());
+        return fallback;
+    }
+    if (std::find(seen.begin(), seen.end(), key.Bits()) == seen.end())
+        seen.push_back(key.Bits());
+    Insert(key, program);
+    return program;
+}
+
+void ShaderPermutations::Reload(const ProgramSource& source)
+{
+    base = source;
+    for (Entry& entry : lru)
+        retired.push_back(entry.program);
+    lru.clear();
+    index.clear();
+    failed.clear();
+    // pre-warms of the old sources are of no use any more
+    for (auto& warm : warming)
+    {
+        if (builder->Wait(warm.second))
+            glDeleteProgram(warm.second->program);
+    }
+    warming.clear();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "AsyncProgramBuilder.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ProgramBinaryCache;
+
+// Optional shader features; each one becomes a #define in the generated variant.
+enum class ShaderFeature : uint32_t
+{
+    Skinning   = 1u << 0,
+    NormalMap  = 1u << 1,
+    Shadow     = 1u << 2,
+    Instancing = 1u << 3,
+};
+
+const uint32_t SHADER_FEATURE_COUNT = 4;
+
+// Set of features identifying one variant. Usable in constant expressions, so variants can be
+// named at compile time: constexpr PermutationKey skinned = ShaderFeature::Skinning | ShaderFeature::Shadow;
+class PermutationKey
+{
+public:
+    constexpr PermutationKey() : bits(0) {}
+    constexpr PermutationKey(ShaderFeature feature) : bits((uint32_t)feature) {}
+    constexpr explicit PermutationKey(uint32_t bits) : bits(bits) {}
+
+    constexpr uint32_t Bits() const { return bits; }
+    constexpr bool Has(ShaderFeature feature) const { return (bits & (uint32_t)feature) != 0; }
+    constexpr PermutationKey With(ShaderFeature feature) const { return PermutationKey(bits | (uint32_t)feature); }
+    constexpr PermutationKey operator|(PermutationKey other) const { return PermutationKey(bits | other.bits); }
+    constexpr bool operator==(PermutationKey other) const { return bits == other.bits; }
+    constexpr bool operator!=(PermutationKey other) const { return bits != other.bits; }
+
+    std::vector<std::string> Defines() const;
+
+private:
+    uint32_t bits;
+};
+
+constexpr PermutationKey operator|(ShaderFeature a, ShaderFeature b)
+{
+    return PermutationKey(a) | PermutationKey(b);
+}
+
+// Variants of one uber shader (shaders/uber.vert, uber.frag), compiled on first use and kept in
+// an LRU of linked programs. Every key requested is remembered in
+// `<cache directory>/<name>.permutations`; on the next run PreWarm submits those variants to the
+// async builder, which restores them from the program binary cache, so they are usually resident
+// before the first frame that needs them.
+// A Get() that has to compile on the spot, or wait for a pre-warm still in flight, is a stall and
+// is reported per frame. Programs evicted from the LRU stay alive until the next BeginFrame, so a
+// program returned earlier in the frame is never deleted under the caller.
+// A variant that fails to build is remembered and answered with the fallback program until Reload,
+// so a broken variant costs one stall rather than one per frame.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const ProgramSource& base, ProgramBinaryCache* cache, const std::string& cacheDirectory, size_t capacity = 64);
+    ~ShaderPermutations();
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    void PreWarm(AsyncProgramBuilder& builder);
+    // Adopts finished pre-warmed variants and rolls the stall counters; call once per frame.
+    void BeginFrame();
+
+    // Returns the linked variant, compiling it synchronously on a miss (the fallback if the build
+    // fails). A variant being pre-warmed is waited for instead of compiled a second time.
+    GLuint Get(PermutationKey key);
+
+    // Program returned for variants that failed to build; 0 unless set.
+    void SetFallback(GLuint program) { fallback = program; }
+    GLuint Fallback() const { return fallback; }
+    // New uber shader sources: drops every resident variant and forgets the failed ones.
+    void Reload(const ProgramSource& source);
+
+    void SaveSeen() const;
+
+    unsigned int StallsLastFrame() const { return stallsLastFrame; }
+    double StallMillisecondsLastFrame() const { return stallMsLastFrame; }
+    size_t Resident() const { return lru.size(); }
+
+private:
+    struct Entry
+    {
+        PermutationKey key;
+        GLuint program;
+    };
+
+    ProgramSource SourceFor(PermutationKey key) const;
+    void Insert(PermutationKey key, GLuint program);
+
+    ProgramSource base;
+    ProgramBinaryCache* cache;
+    std::string seenPath;
+    size_t capacity;
+
+    std::list<Entry> lru; // most recently used first
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> index;
+    std::unordered_map<uint32_t, AsyncProgramHandle> warming;
+    std::unordered_set<uint32_t> failed;
+    GLuint fallback = 0;
+    AsyncProgramBuilder* builder = nullptr; // set by PreWarm
+    std::vector<GLuint> retired; // evicted this frame, deleted by the next BeginFrame
+    std::vector<uint32_t> seen;
+
+    unsigned int stallsThisFrame = 0;
+    double stallMsThisFrame = 0.0;
+    unsigned int stallsLastFrame = 0;
+    double stallMsLastFrame = 0.0;
+};
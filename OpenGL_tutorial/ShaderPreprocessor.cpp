@@ -0,0 +1,683 @@
+#include "ShaderPreprocessor.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    const size_t MAX_INCLUDE_DEPTH = 32;
+
+    // #if evaluation result; `known` is false when only the driver can decide
+    struct Value
+    {
+        bool known;
+        long long v;
+    };
+
+    bool IsDriverMacro(const std::string& name)
+    {
+        return name.compare(0, 3, "GL_") == 0 || name.compare(0, 2, "__") == 0;
+    }
+
+    bool ParseInteger(const std::string& text, long long& value)
+    {
+        size_t begin = text.find_first_not_of(" \t");
+        if (begin == std::string::npos)
+            return false;
+        char* end = nullptr;
+        value = strtoll(text.c_str() + begin, &end, 0);
+        if (end == text.c_str() + begin)
+            return false;
+        while (*end == 'u' || *end == 'U' || *end == ' ' || *end == '\t')
+            ++end;
+        return *end == '\0';
+    }
+
+    std::string Trim(const std::string& text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            return std::string();
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    // blanks out comments, keeping newlines so line numbers don't move
+    std::string StripComments(const std::string& text)
+    {
+        std::string result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '/')
+            {
+                while (i < text.size() && text[i] != '\n')
+                    ++i;
+                if (i < text.size())
+                    result += '\n';
+            }
+            else if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '*')
+            {
+                i += 2;
+                while (i < text.size() && !(text[i] == '*' && i + 1 < text.size() && text[i + 1] == '/'))
+                {
+                    if (text[i] == '\n')
+                        result += '\n';
+                    ++i;
+                }
+                ++i;
+                result += ' ';
+            }
+            else
+                result += text[i];
+        }
+        return result;
+    }
+
+    // recursive descent over #if expressions
+    class Expression
+    {
+    public:
+        Expression(const std::string& text, const std::map<std::string, std::string>& macros, const std::set<std::string>& unknown)
+            : text(text), macros(macros), unknown(unknown) {}
+
+        Value Evaluate()
+        {
+            Value value = Or();
+            Skip();
+            if (failed || pos != text.size())
+                return { false, 0 };
+            return value;
+        }
+
+    private:
+        void Skip()
+        {
+            while (pos < text.size() && isspace((unsigned char)text[pos]))
+                ++pos;
+        }
+
+        bool Accept(const char* op)
+        {
+            Skip();
+            size_t length = strlen(op);
+            if (text.compare(pos, length, op) != 0)
+                return false;
+            // don't read "<=" as "<" or "&&" as "&"
+            if (length == 1 && pos + 1 < text.size() && (text[pos + 1] == '=' || text[pos + 1] == op[0]) && op[0] != '!' && op[0] != '(' && op[0] != ')')
+                return false;
+            if (length == 1 && op[0] == '!' && pos + 1 < text.size() && text[pos + 1] == '=')
+                return false;
+            pos += length;
+            return true;
+        }
+
+        std::string Identifier()
+        {
+            Skip();
+            size_t start = pos;
+            while (pos < text.size() && (isalnum((unsigned char)text[pos]) || text[pos] == '_'))
+                ++pos;
+            return text.substr(start, pos - start);
+        }
+
+        Value Or()
+        {
+            Value left = And();
+            while (Accept("||"))
+            {
+                Value right = And();
+                if ((left.known && left.v) || (right.known && right.v))
+                    left = { true, 1 };
+                else if (left.known && right.known)
+                    left = { true, 0 };
+                else
+                    left = { false, 0 };
+            }
+            return left;
+        }
+
+        Value And()
+        {
+            Value left = Equality();
+            while (Accept("&&"))
+            {
+                Value right = Equality();
+                if ((left.known && !left.v) || (right.known && !right.v))
+                    left = { true, 0 };
+                else if (left.known && right.known)
+                    left = { true, 1 };
+                else
+                    left = { false, 0 };
+            }
+            return left;
+        }
+
+        static Value Combine(Value a, Value b, long long result)
+        {
+            return { a.known && b.known, a.known && b.known ? result : 0 };
+        }
+
+        Value Equality()
+        {
+            Value left = Relational();
+            for (;;)
+            {
+                if (Accept("=="))
+                {
+                    Value right = Relational();
+                    left = Combine(left, right, left.v == right.v);
+                }
+                else if (Accept("!="))
+                {
+                    Value right = Relational();
+                    left = Combine(left, right, left.v != right.v);
+                }
+                else
+                    return left;
+            }
+        }
+
+        Value Relational()
+        {
+            Value left = Additive();
+            for (;;)
+            {
+                if (Accept("<="))
+                {
+                    Value right = Additive();
+                    left = Combine(left, right, left.v <= right.v);
+                }
+                else if (Accept(">="))
+                {
+                    Value right = Additive();
+                    left = Combine(left, right, left.v >= right.v);
+                }
+                else if (Accept("<"))
+                {
+                    Value right = Additive();
+                    left = Combine(left, right, left.v < right.v);
+                }
+                else if (Accept(">"))
+                {
+                    Value right = Additive();
+                    left = Combine(left, right, left.v > right.v);
+                }
+                else
+                    return left;
+            }
+        }
+
+        Value Additive()
+        {
+            Value left = Multiplicative();
+            for (;;)
+            {
+                if (Accept("+"))
+                {
+                    Value right = Multiplicative();
+                    left = Combine(left, right, left.v + right.v);
+                }
+                else if (Accept("-"))
+                {
+                    Value right = Multiplicative();
+                    left = Combine(left, right, left.v - right.v);
+                }
+                else
+                    return left;
+            }
+        }
+
+        Value Multiplicative()
+        {
+            Value left = Unary();
+            for (;;)
+            {
+                if (Accept("*"))
+                {
+                    Value right = Unary();
+                    left = Combine(left, right, left.v * right.v);
+                }
+                else if (Accept("/") || Accept("%"))
+                {
+                    bool divide = text[pos - 1] == '/';
+                    Value right = Unary();
+                    if (right.known && right.v == 0)
+                        left = { false, 0 }; // let the driver report it
+                    else
+                        left = Combine(left, right, divide ? left.v / (right.v ? right.v : 1) : left.v % (right.v ? right.v : 1));
+                }
+                else
+                    return left;
+            }
+        }
+
+        Value Unary()
+        {
+            if (Accept("!"))
+            {
+                Value value = Unary();
+                return { value.known, !value.v };
+            }
+            if (Accept("-"))
+            {
+                Value value = Unary();
+                return { value.known, -value.v };
+            }
+            if (Accept("+"))
+                return Unary();
+            return Primary();
+        }
+
+        Value Primary()
+        {
+            if (Accept("("))
+            {
+                Value value = Or();
+                if (!Accept(")"))
+                    failed = true;
+                return value;
+            }
+
+            Skip();
+            if (pos < text.size() && isdigit((unsigned char)text[pos]))
+            {
+                char* end = nullptr;
+                long long value = strtoll(text.c_str() + pos, &end, 0);
+                pos = end - text.c_str();
+                while (pos < text.size() && (text[pos] == 'u' || text[pos] == 'U'))
+                    ++pos;
+                return { true, value };
+            }
+
+            std::string name = Identifier();
+            if (name.empty())
+            {
+                failed = true;
+                return { false, 0 };
+            }
+
+            if (name == "defined")
+            {
+                bool parens = Accept("(");
+                std::string macro = Identifier();
+                if (parens && !Accept(")"))
+                    failed = true;
+                if (macros.count(macro))
+                    return { true, 1 };
+                if (unknown.count(macro) || IsDriverMacro(macro))
+                    return { false, 0 };
+                return { true, 0 };
+            }
+
+            auto macro = macros.find(name);
+            if (macro != macros.end())
+            {
+                long long value;
+                if (ParseInteger(macro->second, value))
+                    return { true, value };
+                return { false, 0 };
+            }
+            if (unknown.count(name) || IsDriverMacro(name))
+                return { false, 0 };
+            return { true, 0 }; // undefined identifiers are 0, as in C
+        }
+
+        const std::string& text;
+        const std::map<std::string, std::string>& macros;
+        const std::set<std::string>& unknown;
+        size_t pos = 0;
+        bool failed = false;
+    };
+
+    enum class Branch
+    {
+        Taking,      // condition true, emit
+        Skipping,    // condition false, look for #elif/#else
+        Done,        // an earlier branch was taken, drop the rest
+        Passthrough, // undecidable, keep the whole chain for the driver
+    };
+
+    struct Conditional
+    {
+        Branch state;
+        bool dead; // nested inside a dropped branch
+    };
+}
+
+struct ShaderPreprocessor::Context
+{
+    std::map<std::string, std::string> macros;
+    std::set<std::string> unknown; // macros (un)defined inside undecided branches
+    std::set<std::string> onceFiles;
+    std::vector<std::string> includeStack;
+    std::vector<std::string>* files;
+    std::vector<std::string> defines; // injected after #version, or first thing without one
+    bool definesPending = false;
+    std::string output;
+};
+
+void ShaderPreprocessor::AddIncludePath(const std::string& path)
+{
+    includePaths.push_back(path);
+}
+
+void ShaderPreprocessor::Invalidate(const std::string& path)
+{
+    fileCache.erase(std::filesystem::path(path).lexically_normal().generic_string());
+}
+
+void ShaderPreprocessor::ClearCache()
+{
+    fileCache.clear();
+}
+
+const std::string* ShaderPreprocessor::ReadCached(const std::string& path)
+{
+    auto cached = fileCache.find(path);
+    if (cached != fileCache.end())
+        return &cached->second;
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+        return nullptr;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return &(fileCache[path] = stream.str());
+}
+
+std::string ShaderPreprocessor::Resolve(const std::string& include, const std::string& from) const
+{
+    namespace fs = std::filesystem;
+    std::vector<fs::path> candidates;
+    candidates.push_back(fs::path(from).parent_path() / include);
+    for (const std::string& directory : includePaths)
+        candidates.push_back(fs::path(directory) / include);
+
+    for (const fs::path& candidate : candidates)
+    {
+        std::error_code error;
+        if (fs::is_regular_file(candidate, error))
+            return candidate.lexically_normal().generic_string();
+    }
+    return std::string();
+}
+
+PreprocessedSource ShaderPreprocessor::Process(const std::string& path, const std::vector<std::string>& defines)
+{
+    std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+    const std::string* text = ReadCached(normalized);
+    if (!text)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return PreprocessedSource();
+    }
+    return ProcessString(*text, normalized, defines);
+}
+
+PreprocessedSource ShaderPreprocessor::ProcessString(const std::string& source, const std::string& name, const std::vector<std::string>& defines)
+{
+    PreprocessedSource result;
+    Context context;
+    context.files = &result.files;
+    context.defines = defines;
+    context.definesPending = !defines.empty();
+    result.ok = ProcessFile(context, name, source);
+    if (result.ok)
+    {
+        result.code = std::move(context.output);
+        result.hash = Fnv1a(result.code);
+    }
+    return result;
+}
+
+bool ShaderPreprocessor::Expand(const ShaderFiles& files, const std::string& directory, ProgramSource& result, std::set<std::string>* dependencies)
+{
+    result = ProgramSource();
+    result.name = files.name;
+    const std::pair<const std::string*, std::string*> stages[] = {
+        { &files.vertex, &result.vertex },
+        { &files.fragment, &result.fragment },
+        { &files.compute, &result.compute },
+    };
+    for (const auto& stage : stages)
+    {
+        if (stage.first->empty())
+            continue;
+        PreprocessedSource expanded = Process(directory + "/" + *stage.first, files.defines);
+        if (!expanded.ok)
+            return false;
+        *stage.second = std::move(expanded.code);
+        if (dependencies)
+            dependencies->insert(expanded.files.begin(), expanded.files.end());
+    }
+    return true;
+}
+
+bool ShaderPreprocessor::ProcessFile(Context& context, const std::string& path, const std::string& text)
+{
+    if (context.includeStack.size() >= MAX_INCLUDE_DEPTH)
+    {
+        std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP: " << path << std::endl;
+        return false;
+    }
+    context.includeStack.push_back(path);
+
+    size_t fileIndex = std::find(context.files->begin(), context.files->end(), path) - context.files->begin();
+    if (fileIndex == context.files->size())
+        context.files->push_back(path);
+
+    std::vector<Conditional> conditionals;
+    auto active = [&conditionals]() {
+        for (const Conditional& c : conditionals)
+        {
+            if (c.state == Branch::Skipping || c.state == Branch::Done)
+                return false;
+        }
+        return true;
+    };
+    auto uncertain = [&conditionals]() {
+        for (const Conditional& c : conditionals)
+        {
+            if (c.state == Branch::Passthrough)
+                return true;
+        }
+        return false;
+    };
+    auto evaluate = [&context](const std::string& expression) {
+        return Expression(expression, context.macros, context.unknown).Evaluate();
+    };
+    // injected defines go through the same macro table as the source's own
+    auto injectDefines = [&context]() {
+        for (const std::string& define : context.defines)
+        {
+            size_t end = define.find_first_of(" \t(");
+            std::string macro = define.substr(0, end);
+            bool function = end != std::string::npos && define[end] == '(';
+            context.macros[macro] = function ? std::string("(") : (end == std::string::npos ? std::string() : Trim(define.substr(end)));
+            context.output += "#define " + define + "\n";
+        }
+        context.definesPending = false;
+    };
+
+    std::istringstream lines(StripComments(text));
+    std::string line;
+    size_t lineNumber = 0;
+    bool ok = true;
+    while (ok && std::getline(lines, line))
+    {
+        ++lineNumber;
+        std::string trimmed = Trim(line);
+        // a root file without #version gets the defines ahead of its first statement
+        if (context.definesPending && context.includeStack.size() == 1 && !trimmed.empty()
+            && !(trimmed[0] == '#' && Trim(trimmed.substr(1)).compare(0, 7, "version") == 0))
+        {
+            injectDefines();
+            context.output += "#line " + std::to_string(lineNumber) + " " + std::to_string(fileIndex) + "\n";
+        }
+        if (trimmed.empty() || trimmed[0] != '#')
+        {
+            context.output += active() ? line : std::string();
+            context.output += '\n';
+            continue;
+        }
+
+        std::string body = Trim(trimmed.substr(1));
+        size_t nameEnd = 0;
+        while (nameEnd < body.size() && isalpha((unsigned char)body[nameEnd]))
+            ++nameEnd;
+        std::string directive = body.substr(0, nameEnd);
+        std::string argument = Trim(body.substr(nameEnd));
+
+        bool emit = false;
+        if (directive == "if" || directive == "ifdef" || directive == "ifndef")
+        {
+            if (!active())
+                conditionals.push_back({ Branch::Skipping, true });
+            else
+            {
+                Value value;
+                if (directive == "if")
+                    value = evaluate(argument);
+                else
+                {
+                    value = evaluate("defined(" + argument + ")");
+                    if (directive == "ifndef")
+                        value.v = !value.v;
+                }
+                if (!value.known)
+                {
+                    conditionals.push_back({ Branch::Passthrough, false });
+                    emit = true;
+                }
+                else
+                    conditionals.push_back({ value.v ? Branch::Taking : Branch::Skipping, false });
+            }
+        }
+        else if (directive == "elif" || directive == "else")
+        {
+            if (conditionals.empty())
+            {
+                std::cout << "ERROR::SHADER::UNMATCHED_" << directive << " in " << path << ":" << lineNumber << std::endl;
+                ok = false;
+                break;
+            }
+            Conditional& top = conditionals.back();
+            if (top.dead)
+            {
+                // the whole chain is inside a dropped branch
+            }
+            else if (top.state == Branch::Passthrough)
+                emit = true;
+            else if (top.state == Branch::Taking)
+                top.state = Branch::Done;
+            else if (top.state == Branch::Skipping)
+            {
+                Value value = directive == "else" ? Value{ true, 1 } : evaluate(argument);
+                if (!value.known)
+                {
+                    // earlier branches were dropped, so the chain restarts here for the driver
+                    top.state = Branch::Passthrough;
+                    context.output += "#if " + argument + "\n";
+                    continue;
+                }
+                top.state = value.v ? Branch::Taking : Branch::Skipping;
+            }
+        }
+        else if (directive == "endif")
+        {
+            if (conditionals.empty())
+            {
+                std::cout << "ERROR::SHADER::UNMATCHED_endif in " << path << ":" << lineNumber << std::endl;
+                ok = false;
+                break;
+            }
+            emit = conditionals.back().state == Branch::Passthrough && !conditionals.back().dead;
+            conditionals.pop_back();
+        }
+        else if (!active())
+        {
+            // any other directive in a dropped branch disappears with it
+        }
+        else if (directive == "define" || directive == "undef")
+        {
+            size_t end = 0;
+            while (end < argument.size() && (isalnum((unsigned char)argument[end]) || argument[end] == '_'))
+                ++end;
+            std::string macro = argument.substr(0, end);
+            if (uncertain())
+            {
+                context.unknown.insert(macro);
+                context.macros.erase(macro);
+            }
+            else if (directive == "undef")
+                context.macros.erase(macro);
+            else
+            {
+                // function-like macros can't be evaluated here
+                bool function = end < argument.size() && argument[end] == '(';
+                context.macros[macro] = function ? std::string("(") : Trim(argument.substr(end));
+                context.unknown.erase(macro);
+            }
+            emit = true;
+        }
+        else if (directive == "pragma" && argument == "once")
+        {
+            context.onceFiles.insert(path);
+        }
+        else if (directive == "include")
+        {
+            size_t open = argument.find_first_of("\"<");
+            size_t close = open == std::string::npos ? open : argument.find_first_of("\">", open + 1);
+            std::string resolved = close == std::string::npos ? std::string() : Resolve(argument.substr(open + 1, close - open - 1), path);
+            const std::string* included = resolved.empty() ? nullptr : ReadCached(resolved);
+            if (!included)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << argument << " in " << path << ":" << lineNumber << std::endl;
+                ok = false;
+                break;
+            }
+            if (std::find(context.includeStack.begin(), context.includeStack.end(), resolved) != context.includeStack.end())
+            {
+                std::cout << "ERROR::SHADER::RECURSIVE_INCLUDE: " << resolved << std::endl;
+                ok = false;
+                break;
+            }
+            if (context.onceFiles.count(resolved) == 0)
+            {
+                size_t childIndex = std::find(context.files->begin(), context.files->end(), resolved) - context.files->begin();
+                context.output += "#line 1 " + std::to_string(childIndex) + "\n";
+                ok = ProcessFile(context, resolved, *included);
+                context.output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+                continue;
+            }
+        }
+        else if (directive == "version" && context.includeStack.size() == 1 && context.definesPending)
+        {
+            context.output += line + "\n";
+            injectDefines();
+            context.output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            continue;
+        }
+        else
+            emit = true; // #version, #extension, #line, #error, other #pragma: for the driver
+
+        context.output += emit ? line : std::string();
+        context.output += '\n';
+    }
+
+    if (ok && !conditionals.empty())
+    {
+        std::cout << "ERROR::SHADER::UNTERMINATED_CONDITIONAL in " << path << std::endl;
+        ok = false;
+    }
+    context.includeStack.pop_back();
+    return ok;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+struct PreprocessedSource
+{
+    bool ok = false;
+    std::string code;
+    // FNV-1a of `code`; equal hashes mean the driver would see identical text
+    uint64_t hash = 0;
+    // every file that contributed, index = GLSL source-string number used in #line
+    std::vector<std::string> files;
+};
+
+// CPU-side GLSL preprocessor run before the source reaches the driver.
+//  - resolves #include "file" (relative to the including file, then the include paths),
+//    honouring #pragma once and include guards;
+//  - injects defines right after #version, or ahead of the first statement without one;
+//  - strips comments and removes #if/#ifdef/#ifndef/#elif/#else branches whose condition can
+//    be decided here. Conditions on driver-defined macros (GL_*, __VERSION__, ...) or on macros
+//    defined inside such a block are left in place for the driver.
+// Dropped lines are kept as empty lines and every include is wrapped in #line directives, so
+// driver error messages still point at the right file and line.
+// The expansion never mentions file paths, so the same shader reached through two paths
+// expands to the same text and hash.
+class ShaderPreprocessor
+{
+public:
+    void AddIncludePath(const std::string& path);
+
+    PreprocessedSource Process(const std::string& path, const std::vector<std::string>& defines);
+    PreprocessedSource ProcessString(const std::string& source, const std::string& name, const std::vector<std::string>& defines);
+    // Expands every stage of a program; the result carries no defines, they are already applied.
+    // `dependencies` receives every file that was read.
+    bool Expand(const ShaderFiles& files, const std::string& directory, ProgramSource& result, std::set<std::string>* dependencies = nullptr);
+
+    // File contents are cached between calls; drop them when files change on disk.
+    void Invalidate(const std::string& path);
+    void ClearCache();
+
+private:
+    struct Context;
+
+    bool ProcessFile(Context& context, const std::string& path, const std::string& text);
+    const std::string* ReadCached(const std::string& path);
+    std::string Resolve(const std::string& include, const std::string& from) const;
+
+    std::vector<std::string> includePaths;
+    std::map<std::string, std::string> fileCache;
+};
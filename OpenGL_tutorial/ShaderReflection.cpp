@@ -0,0 +1,203 @@
+#include "ShaderReflection.h"
+
+namespace
+{
+    // bytes of one element of a default-block uniform
+    uint32_t UniformSize(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: return 8;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3: return 12;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: return 16;
+        case GL_FLOAT_MAT2: return 16;
+        case GL_FLOAT_MAT3: return 36;
+        case GL_FLOAT_MAT4: return 64;
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: return 24;
+        case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: return 32;
+        case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3: return 48;
+        case GL_DOUBLE: return 8;
+        case GL_DOUBLE_VEC2: return 16;
+        case GL_DOUBLE_VEC3: return 24;
+        case GL_DOUBLE_VEC4: return 32;
+        case GL_DOUBLE_MAT2: return 32;
+        case GL_DOUBLE_MAT3: return 72;
+        case GL_DOUBLE_MAT4: return 128;
+        case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT3x2: return 48;
+        case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT4x2: return 64;
+        case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x3: return 96;
+        default: return 4; // scalars, bools, samplers and images
+        }
+    }
+
+    bool IsDouble(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_DOUBLE: case GL_DOUBLE_VEC2: case GL_DOUBLE_VEC3: case GL_DOUBLE_VEC4:
+        case GL_DOUBLE_MAT2: case GL_DOUBLE_MAT3: case GL_DOUBLE_MAT4:
+        case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT3x2: case GL_DOUBLE_MAT2x4:
+        case GL_DOUBLE_MAT4x2: case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x3: return true;
+        default: return false;
+        }
+    }
+
+    std::string ResourceName(GLuint program, GLenum interface, GLuint index, GLint length)
+    {
+        std::string name(length > 0 ? length : 1, '\0');
+        glGetProgramResourceName(program, interface, index, (GLsizei)name.size(), NULL, &name[0]);
+        name.resize(strlen(name.c_str()));
+        // arrays are reported as "name[0]"
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            name.resize(name.size() - 3);
+        return name;
+    }
+}
+
+void ProgramReflection::Reflect(GLuint reflected)
+{
+    program = reflected;
+    resources.clear();
+    storage.clear();
+
+    GLint count = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+        GLint values[5];
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 5, properties, 5, NULL, values);
+        // members of uniform blocks live in buffer memory, not in the default block
+        if (values[4] != -1)
+            continue;
+
+        ReflectedResource resource = {};
+        resource.name = ResourceName(program, GL_UNIFORM, i, values[0]);
+        resource.hash = Fnv1a(resource.name);
+        resource.kind = ResourceKind::Uniform;
+        resource.type = values[1];
+        resource.location = values[2];
+        resource.arraySize = values[3];
+        resource.binding = -1;
+        // the storage is read back through typed pointers in Apply
+        uint32_t alignment = IsDouble(resource.type) ? 8 : 4;
+        resource.offset = ((uint32_t)storage.size() + alignment - 1) & ~(alignment - 1);
+        resource.size = UniformSize(resource.type) * resource.arraySize;
+        storage.resize(resource.offset + resource.size);
+        resources.push_back(resource);
+    }
+
+    const std::pair<GLenum, ResourceKind> blocks[] = {
+        { GL_UNIFORM_BLOCK, ResourceKind::UniformBlock },
+        { GL_SHADER_STORAGE_BLOCK, ResourceKind::StorageBlock },
+    };
+    for (const auto& block : blocks)
+    {
+        glGetProgramInterfaceiv(program, block.first, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            const GLenum properties[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+            GLint values[3];
+            glGetProgramResourceiv(program, block.first, i, 3, properties, 3, NULL, values);
+
+            ReflectedResource resource = {};
+            resource.name = ResourceName(program, block.first, i, values[0]);
+            resource.hash = Fnv1a(resource.name);
+            resource.kind = block.second;
+            resource.location = -1;
+            resource.binding = values[1];
+            resource.dataSize = values[2];
+            resources.push_back(resource);
+        }
+    }
+
+    // open addressing, at most half full
+    size_t buckets = 4;
+    while (buckets < resources.size() * 2)
+        buckets *= 2;
+    table.assign(buckets, -1);
+    tableMask = buckets - 1;
+    for (size_t slot = 0; slot < resources.size(); ++slot)
+    {
+        uint64_t bucket = resources[slot].hash & tableMask;
+        while (table[bucket] != -1)
+            bucket = (bucket + 1) & tableMask;
+        table[bucket] = (int32_t)slot;
+    }
+
+    dirty.assign(resources.size(), 0);
+    dirtySlots.clear();
+}
+
+int ProgramReflection::Find(uint64_t hash) const
+{
+    if (table.empty())
+        return -1;
+    for (uint64_t bucket = hash & tableMask;; bucket = (bucket + 1) & tableMask)
+    {
+        int32_t slot = table[bucket];
+        if (slot == -1)
+            return -1;
+        if (resources[slot].hash == hash)
+            return slot;
+    }
+}
+
+void ProgramReflection::Apply()
+{
+    for (int slot : dirtySlots)
+    {
+        const ReflectedResource& resource = resources[slot];
+        dirty[slot] = 0;
+        if (resource.location < 0)
+            continue;
+
+        const void* data = &storage[resource.offset];
+        const GLfloat* f = (const GLfloat*)data;
+        const GLint* i = (const GLint*)data;
+        const GLuint* u = (const GLuint*)data;
+        const GLdouble* d = (const GLdouble*)data;
+        GLint n = resource.arraySize;
+        switch (resource.type)
+        {
+        case GL_FLOAT:             glProgramUniform1fv(program, resource.location, n, f); break;
+        case GL_FLOAT_VEC2:        glProgramUniform2fv(program, resource.location, n, f); break;
+        case GL_FLOAT_VEC3:        glProgramUniform3fv(program, resource.location, n, f); break;
+        case GL_FLOAT_VEC4:        glProgramUniform4fv(program, resource.location, n, f); break;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:         glProgramUniform2iv(program, resource.location, n, i); break;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:         glProgramUniform3iv(program, resource.location, n, i); break;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:         glProgramUniform4iv(program, resource.location, n, i); break;
+        case GL_UNSIGNED_INT:      glProgramUniform1uiv(program, resource.location, n, u); break;
+        case GL_UNSIGNED_INT_VEC2: glProgramUniform2uiv(program, resource.location, n, u); break;
+        case GL_UNSIGNED_INT_VEC3: glProgramUniform3uiv(program, resource.location, n, u); break;
+        case GL_UNSIGNED_INT_VEC4: glProgramUniform4uiv(program, resource.location, n, u); break;
+        case GL_FLOAT_MAT2:        glProgramUniformMatrix2fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3:        glProgramUniformMatrix3fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4:        glProgramUniformMatrix4fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT2x3:      glProgramUniformMatrix2x3fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3x2:      glProgramUniformMatrix3x2fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT2x4:      glProgramUniformMatrix2x4fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4x2:      glProgramUniformMatrix4x2fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3x4:      glProgramUniformMatrix3x4fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4x3:      glProgramUniformMatrix4x3fv(program, resource.location, n, GL_FALSE, f); break;
+        case GL_DOUBLE:            glProgramUniform1dv(program, resource.location, n, d); break;
+        case GL_DOUBLE_VEC2:       glProgramUniform2dv(program, resource.location, n, d); break;
+        case GL_DOUBLE_VEC3:       glProgramUniform3dv(program, resource.location, n, d); break;
+        case GL_DOUBLE_VEC4:       glProgramUniform4dv(program, resource.location, n, d); break;
+        case GL_DOUBLE_MAT2:       glProgramUniformMatrix2dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT3:       glProgramUniformMatrix3dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT4:       glProgramUniformMatrix4dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT2x3:     glProgramUniformMatrix2x3dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT3x2:     glProgramUniformMatrix3x2dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT2x4:     glProgramUniformMatrix2x4dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT4x2:     glProgramUniformMatrix4x2dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT3x4:     glProgramUniformMatrix3x4dv(program, resource.location, n, GL_FALSE, d); break;
+        case GL_DOUBLE_MAT4x3:     glProgramUniformMatrix4x3dv(program, resource.location, n, GL_FALSE, d); break;
+        default:                   glProgramUniform1iv(program, resource.location, n, i); break; // int, bool, samplers, images
+        }
+    }
+    dirtySlots.clear();
+}
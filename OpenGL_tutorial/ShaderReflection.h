@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Hash.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum class ResourceKind : uint8_t
+{
+    Uniform,
+    UniformBlock,
+    StorageBlock,
+};
+
+struct ReflectedResource
+{
+    uint64_t hash; // Fnv1a of the name, without a trailing "[0]"
+    std::string name;
+    ResourceKind kind;
+    GLenum type;       // uniforms only
+    GLint location;    // uniforms only
+    GLint arraySize;   // uniforms only
+    GLint binding;     // blocks only
+    GLint dataSize;    // blocks only
+    uint32_t offset;   // uniforms: offset of the value in the parameter storage, 8-aligned for doubles
+    uint32_t size;     // uniforms: bytes in the parameter storage
+};
+
+// Everything a program exposes, gathered once at link time with glGetProgramInterfaceiv /
+// glGetProgramResourceiv: the default-block uniforms, uniform blocks and shader storage blocks.
+// Resources live in a flat open-addressing table keyed by name hash, and names can be hashed
+// at compile time ("uModel"_hash), so nothing is looked up by string while drawing.
+// Uniform values go to a CPU-side parameter storage: Set is one indexed write plus a dirty
+// flag, and Apply uploads only the dirty ones with glProgramUniform* (no glUseProgram needed).
+class ProgramReflection
+{
+public:
+    void Reflect(GLuint program);
+
+    // Slot of the resource, or -1 if the program doesn't have it (e.g. optimised out).
+    int Find(uint64_t hash) const;
+    const ReflectedResource& Resource(int slot) const { return resources[slot]; }
+    const std::vector<ReflectedResource>& Resources() const { return resources; }
+
+    // Writes through a slot from Find; a slot of -1 is ignored.
+    template<typename T>
+    void SetSlot(int slot, const T& value)
+    {
+        if (slot < 0)
+            return;
+        const ReflectedResource& resource = resources[slot];
+        memcpy(&storage[resource.offset], &value, sizeof(T) < resource.size ? sizeof(T) : resource.size);
+        if (!dirty[slot])
+        {
+            dirty[slot] = 1;
+            dirtySlots.push_back(slot);
+        }
+    }
+
+    template<typename T>
+    void Set(uint64_t hash, const T& value) { SetSlot(Find(hash), value); }
+
+    // Uploads the values written since the last Apply.
+    void Apply();
+
+    GLuint Program() const { return program; }
+
+private:
+    GLuint program = 0;
+    std::vector<ReflectedResource> resources;
+    std::vector<int32_t> table; // slot per bucket, -1 when empty
+    uint64_t tableMask = 0;
+
+    std::vector<unsigned char> storage;
+    std::vector<unsigned char> dirty;
+    std::vector<int> dirtySlots;
+};
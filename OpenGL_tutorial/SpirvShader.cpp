@@ -0,0 +1,100 @@
+#include "SpirvShader.h"
+#include "Shader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+bool SpirvSupported()
+{
+    return GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_gl_spirv;
+}
+
+std::string SpirvModulePath(const std::string& module)
+{
+    std::string optimised = "shaders/spirv/opt/" + module;
+    std::error_code error;
+    return std::filesystem::exists(optimised, error) ? optimised : "shaders/spirv/" + module;
+}
+
+std::vector<char> ReadSpirvFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return std::vector<char>();
+    }
+    std::vector<char> binary((size_t)file.tellg());
+    file.seekg(0);
+    file.read(binary.data(), binary.size());
+    // a SPIR-V module is a stream of 32-bit words
+    if (binary.size() % 4 != 0)
+    {
+        std::cout << "ERROR::SHADER::INVALID_SPIRV: " << path << std::endl;
+        return std::vector<char>();
+    }
+    return binary;
+}
+
+GLuint LoadSpirvShader(const SpirvStage& stage)
+{
+    std::vector<char> binary = ReadSpirvFile(stage.path);
+    if (binary.empty())
+        return 0;
+
+    std::vector<GLuint> ids;
+    std::vector<GLuint> values;
+    for (const SpecializationConstant& constant : stage.constants)
+    {
+        ids.push_back(constant.id);
+        values.push_back(constant.value);
+    }
+
+    GLuint shader = glCreateShader(stage.type);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, binary.data(), (GLsizei)binary.size());
+    glSpecializeShader(shader, stage.entryPoint.c_str(), (GLuint)ids.size(), ids.data(), values.data());
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(length > 0 ? length : 1, '\0');
+        glGetShaderInfoLog(shader, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+        std::cout << "ERROR::SHADER_SPECIALIZATION_ERROR in " << stage.path << "\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint BuildSpirvProgram(const std::vector<SpirvStage>& stages, const std::string& name)
+{
+    if (!SpirvSupported())
+    {
+        std::cout << "SPIR-V shaders not supported by the driver" << std::endl;
+        return 0;
+    }
+
+    std::vector<GLuint> shaders;
+    GLuint program = 0;
+    bool ok = true;
+    for (const SpirvStage& stage : stages)
+    {
+        GLuint shader = LoadSpirvShader(stage);
+        if (shader == 0)
+        {
+            ok = false;
+            break;
+        }
+        shaders.push_back(shader);
+    }
+
+    if (ok)
+        program = LinkProgram(shaders, name, false);
+    for (GLuint shader : shaders)
+        glDeleteShader(shader);
+    return program;
+}
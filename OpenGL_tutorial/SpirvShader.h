@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// SPIR-V ingestion through GL 4.6 / ARB_gl_spirv.
+// Modules are produced offline by tools/compile_shaders.sh (VertexShader.hlsl included), so the
+// driver skips the GLSL front end entirely: glShaderBinary + glSpecializeShader replace
+// glShaderSource + glCompileShader.
+struct SpecializationConstant
+{
+    GLuint id;    // constant_id in the shader
+    GLuint value; // raw 32-bit value (reinterpret floats)
+};
+
+struct SpirvStage
+{
+    GLenum type;
+    std::string path;
+    std::string entryPoint = "main";
+    std::vector<SpecializationConstant> constants;
+};
+
+bool SpirvSupported();
+// Path of a module under shaders/spirv, e.g. "basic.frag.spv". The spirv-opt output of
+// tools/validate_shaders.sh (shaders/spirv/opt) is preferred, so the code the driver gets is the
+// code the validation report measured; the unoptimised module is the fallback.
+std::string SpirvModulePath(const std::string& module);
+std::vector<char> ReadSpirvFile(const std::string& path);
+
+GLuint LoadSpirvShader(const SpirvStage& stage);
+GLuint BuildSpirvProgram(const std::vector<SpirvStage>& stages, const std::string& name);
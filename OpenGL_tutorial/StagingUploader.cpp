@@ -0,0 +1,388 @@
+#include "StagingUploader.h"
+
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const GLsizeiptr STAGING_ALIGNMENT = 16;
+
+    // the same buffer, or the same level of the same texture
+    bool SameDestination(bool textureA, GLuint targetA, GLint levelA, bool textureB, GLuint targetB, GLint levelB)
+    {
+        return textureA == textureB && targetA == targetB && (!textureA || levelA == levelB);
+    }
+}
+
+StagingUploader::~StagingUploader()
+{
+    Destroy();
+}
+
+bool StagingUploader::Create(GLsizeiptr stagingSize, GLsizeiptr budgetPerFrame)
+{
+    if (!GLAD_GL_VERSION_4_5 && !(GLAD_GL_ARB_buffer_storage && GLAD_GL_ARB_direct_state_access))
+    {
+        std::cout << "ARB_buffer_storage / ARB_direct_state_access not supported, staging uploads unavailable" << std::endl;
+        return false;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &staging);
+    glNamedBufferStorage(staging, stagingSize, NULL, flags);
+    mapped = (unsigned char*)glMapNamedBufferRange(staging, 0, stagingSize, flags);
+    if (!mapped)
+    {
+        std::cout << "Failed to map staging buffer" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    capacity = stagingSize;
+    // a frame staging more than half the ring would leave nothing for the next one while it is in flight
+    budget = budgetLeft = std::min(budgetPerFrame, stagingSize / 2);
+    head = tail = used = frameBytes = 0;
+    return true;
+}
+
+void StagingUploader::Destroy()
+{
+    for (Segment& segment : segments)
+        glDeleteSync(segment.fence);
+    segments.clear();
+    if (staging != 0)
+    {
+        // deleting a mapped buffer unmaps it
+        glDeleteBuffers(1, &staging);
+        GLState().ForgetBuffer(staging);
+        staging = 0;
+    }
+    mapped = nullptr;
+    pending.clear();
+    copies.clear();
+    pendingBytes = 0;
+}
+
+void StagingUploader::WriteBuffer(GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size)
+{
+    Request request = {};
+    request.texture = false;
+    request.target = buffer;
+    request.offset = offset;
+    request.size = size;
+    Submit(request, (const unsigned char*)data);
+}
+
+void StagingUploader::WriteBuffer(const GpuHeap& heap, GpuHeap::Handle block, GLintptr offset, const void* data, GLsizeiptr size)
+{
+    Request request = {};
+    request.texture = false;
+    request.heap = &heap;
+    request.block = block;
+    request.offset = offset;
+    request.size = size;
+    Submit(request, (const unsigned char*)data);
+}
+
+void StagingUploader::WriteTexture(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, const void* data, GLsizeiptr size)
+{
+    if (height <= 0 || size % height != 0)
+    {
+        std::cout << "ERROR::STAGING_UPLOAD texture " << texture << ": " << size << " bytes is not a whole number of rows" << std::endl;
+        return;
+    }
+    Request request = {};
+    request.texture = true;
+    request.target = texture;
+    request.level = level;
+    request.x = x;
+    request.y = y;
+    request.width = width;
+    request.height = height;
+    request.format = format;
+    request.type = type;
+    request.rowBytes = size / height;
+    request.size = size;
+    if (request.rowBytes > budget)
+    {
+        std::cout << "ERROR::STAGING_UPLOAD texture " << texture << ": a row of " << request.rowBytes
+            << " bytes exceeds the per-frame budget" << std::endl;
+        return;
+    }
+    Submit(request, (const unsigned char*)data);
+}
+
+void StagingUploader::Submit(Request& request, const unsigned char* data)
+{
+    writesThisFrame++;
+    if (!mapped || request.size <= 0)
+        return;
+
+    // writes queued before this one have to land first, so only stage directly when nothing waits
+    if (pending.empty() && Stage(request, data))
+        return;
+
+    request.dataStart = request.done;
+    request.data.assign(data + request.done, data + request.size);
+    pendingBytes += request.size - request.done;
+    pending.push_back(std::move(request));
+}
+
+bool StagingUploader::Stage(Request& request, const unsigned char* data)
+{
+    while (request.done < request.size)
+    {
+        GLsizeiptr chunk = std::min(budgetLeft, request.size - request.done);
+        if (request.texture)
+            chunk = chunk / request.rowBytes * request.rowBytes;
+        if (chunk <= 0)
+            return false;
+
+        GLintptr source = Reserve(chunk);
+        if (source < 0)
+        {
+            starvedThisFrame = true;
+            return false;
+        }
+        memcpy(mapped + source, data + (request.done - request.dataStart), chunk);
+
+        Copy copy = {};
+        copy.texture = request.texture;
+        copy.target = request.target;
+        copy.source = source;
+        copy.size = chunk;
+        copy.sequence = (unsigned int)copies.size();
+        if (request.texture)
+        {
+            copy.level = request.level;
+            copy.x = request.x;
+            copy.y = request.y + (GLint)(request.done / request.rowBytes);
+            copy.width = request.width;
+            copy.height = (GLsizei)(chunk / request.rowBytes);
+            copy.format = request.format;
+            copy.type = request.type;
+            copy.rowBytes = request.rowBytes;
+        }
+        else
+        {
+            copy.offset = request.offset + request.done;
+            copy.heap = request.heap;
+            copy.block = request.block;
+        }
+        copies.push_back(copy);
+
+        request.done += chunk;
+        budgetLeft -= chunk;
+    }
+    return true;
+}
+
+GLintptr StagingUploader::Reserve(GLsizeiptr size)
+{
+    // fences are only polled when the ring looks full
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        if (attempt > 0)
+        {
+            if (segments.empty())
+                break;
+            Reclaim();
+        }
+        if (used == 0)
+            head = tail = 0;
+
+        GLintptr start = (head + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+        GLsizeiptr consumed;
+        if (used == 0 || head > tail)
+        {
+            // free space is [head, capacity) and [0, tail)
+            if (start + size <= capacity)
+                consumed = start + size - head;
+            else if (size <= tail)
+            {
+                consumed = capacity - head + size;
+                start = 0;
+            }
+            else
+                continue;
+        }
+        else
+        {
+            // wrapped: free space is [head, tail)
+            if (start + size > tail)
+                continue;
+            consumed = start + size - head;
+        }
+
+        head = start + size;
+        used += consumed;
+        frameBytes += consumed;
+        return start;
+    }
+    return -1;
+}
+
+void StagingUploader::Reclaim()
+{
+    while (!segments.empty())
+    {
+        Segment& segment = segments.front();
+        if (glClientWaitSync(segment.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        glDeleteSync(segment.fence);
+        tail = segment.end;
+        used -= segment.bytes;
+        segments.pop_front();
+    }
+}
+
+void StagingUploader::ResolveHeapCopies()
+{
+    for (Copy& copy : copies)
+    {
+        if (!copy.heap)
+            continue;
+        copy.target = copy.heap->Buffer();
+        copy.offset += copy.heap->Offset(copy.block);
+        copy.heap = nullptr;
+    }
+}
+
+void StagingUploader::SortCopies()
+{
+    auto position = [](const Copy& c) { return c.texture ? (GLintptr)c.y : c.offset; };
+    auto extent = [](const Copy& c) { return c.texture ? (GLintptr)c.y + c.height : c.offset + c.size; };
+
+    std::sort(copies.begin(), copies.end(), [&](const Copy& a, const Copy& b) {
+        if (a.texture != b.texture) return a.texture < b.texture;
+        if (a.target != b.target) return a.target < b.target;
+        if (a.texture && a.level != b.level) return a.level < b.level;
+        if (position(a) != position(b)) return position(a) < position(b);
+        return a.sequence < b.sequence;
+    });
+
+    // overlapping writes to one destination keep their submission order so the last write wins
+    size_t begin = 0;
+    while (begin < copies.size())
+    {
+        size_t end = begin + 1;
+        bool overlap = false;
+        GLintptr reach = extent(copies[begin]);
+        while (end < copies.size() && SameDestination(copies[begin].texture, copies[begin].target, copies[begin].level,
+            copies[end].texture, copies[end].target, copies[end].level))
+        {
+            overlap = overlap || position(copies[end]) < reach;
+            reach = std::max(reach, extent(copies[end]));
+            end++;
+        }
+        if (overlap)
+        {
+            std::sort(copies.begin() + begin, copies.begin() + end,
+                [](const Copy& a, const Copy& b) { return a.sequence < b.sequence; });
+        }
+        begin = end;
+    }
+
+    // neighbours in both the staging ring and the destination become one copy
+    size_t merged = 0;
+    for (size_t i = 1; i < copies.size(); ++i)
+    {
+        Copy& last = copies[merged];
+        const Copy& next = copies[i];
+        bool contiguous = SameDestination(last.texture, last.target, last.level, next.texture, next.target, next.level)
+            && last.source + last.size == next.source;
+        if (contiguous && !last.texture)
+            contiguous = last.offset + last.size == next.offset;
+        else if (contiguous)
+        {
+            contiguous = last.x == next.x && last.width == next.width && last.y + last.height == next.y
+                && last.format == next.format && last.type == next.type && last.rowBytes == next.rowBytes;
+        }
+
+        if (contiguous)
+        {
+            last.size += next.size;
+            last.height += next.height;
+        }
+        else
+            copies[++merged] = next;
+    }
+    if (!copies.empty())
+        copies.resize(merged + 1);
+}
+
+void StagingUploader::IssueCopies()
+{
+    bool unpackBound = false;
+    GLint unpackAlignment = 4;
+    for (const Copy& copy : copies)
+    {
+        if (!copy.texture)
+        {
+            glCopyNamedBufferSubData(staging, copy.target, copy.source, copy.offset, copy.size);
+            continue;
+        }
+        if (!unpackBound)
+        {
+            // rows are tightly packed in the staging ring
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            GLState().BindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+            unpackBound = true;
+        }
+        glTextureSubImage2D(copy.target, copy.level, copy.x, copy.y, copy.width, copy.height,
+            copy.format, copy.type, (const void*)copy.source);
+    }
+    if (unpackBound)
+    {
+        GLState().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    }
+}
+
+void StagingUploader::Flush()
+{
+    auto start = std::chrono::steady_clock::now();
+    Reclaim();
+
+    // continue queued uploads with what is left of this frame's budget
+    while (!pending.empty())
+    {
+        Request& request = pending.front();
+        GLsizeiptr before = request.done;
+        bool finished = Stage(request, request.data.data());
+        pendingBytes -= request.done - before;
+        if (!finished)
+            break;
+        pending.pop_front();
+    }
+
+    for (const Copy& copy : copies)
+        bytesUploaded += copy.size;
+    // nothing can move a heap block between here and the copies being issued
+    ResolveHeapCopies();
+    SortCopies();
+    IssueCopies();
+    copiesLastFrame = (unsigned int)copies.size();
+    copies.clear();
+
+    if (frameBytes > 0)
+    {
+        Segment segment = { glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), head, frameBytes };
+        segments.push_back(segment);
+        frameBytes = 0;
+    }
+
+    writesLastFrame = writesThisFrame;
+    writesThisFrame = 0;
+    if (starvedThisFrame)
+        starved++;
+    starvedThisFrame = false;
+    budgetLeft = budget;
+    flushSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
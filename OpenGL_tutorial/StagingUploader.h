@@ -0,0 +1,121 @@
+#pragma once
+
+#include "GpuHeap.h"
+
+#include <glad/glad.h>
+
+#include <deque>
+#include <vector>
+
+// Render-thread uploads into existing buffers and textures through a persistently mapped
+// staging ring (ARB_buffer_storage).
+// Writes are copied into the ring as they arrive and turned into GPU copies at Flush, sorted by
+// destination so neighbouring writes merge into a single glCopyNamedBufferSubData or
+// glTextureSubImage2D call. Each Flush ends with a fence; staging space is reused once the
+// fence has signalled, never by waiting on it.
+// At most `budgetPerFrame` bytes are staged per frame. Larger uploads, or uploads that find
+// the ring still busy, are queued and continue over the next frames in submission order.
+class StagingUploader
+{
+public:
+    ~StagingUploader();
+
+    bool Create(GLsizeiptr stagingSize, GLsizeiptr budgetPerFrame);
+    void Destroy();
+
+    // `data` is copied before returning.
+    void WriteBuffer(GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size);
+    // Writes into a GpuHeap block. Its offset is looked up when each copy is issued, so the write
+    // lands in the right place even if Defragment moves the block while it is queued. The block
+    // must stay allocated until the write has been flushed.
+    void WriteBuffer(const GpuHeap& heap, GpuHeap::Handle block, GLintptr offset, const void* data, GLsizeiptr size);
+    // Tightly packed rows; large images are split by rows across frames.
+    void WriteTexture(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+        GLenum format, GLenum type, const void* data, GLsizeiptr size);
+
+    // Issues this frame's copies; call once per frame on the render thread.
+    void Flush();
+
+    GLsizeiptr PendingBytes() const { return pendingBytes; }
+    unsigned long long BytesUploaded() const { return bytesUploaded; }
+    unsigned int CopiesLastFrame() const { return copiesLastFrame; }
+    unsigned int WritesLastFrame() const { return writesLastFrame; }
+    // frames that stopped staging because the ring was still in use by the GPU
+    unsigned int Starved() const { return starved; }
+    double FlushSeconds() const { return flushSeconds; }
+
+private:
+    struct Request
+    {
+        bool texture;
+        GLuint target;
+        GLintptr offset;          // buffers; relative to the block for heap writes
+        const GpuHeap* heap;
+        GpuHeap::Handle block;
+        GLint level, x, y;        // textures
+        GLsizei width, height;
+        GLenum format, type;
+        GLsizeiptr rowBytes;
+        GLsizeiptr size;
+        GLsizeiptr done = 0;      // bytes staged so far
+        std::vector<unsigned char> data; // queued requests only, the bytes not staged on submit
+        GLsizeiptr dataStart = 0; // request byte held by data[0]
+    };
+
+    struct Copy
+    {
+        bool texture;
+        GLuint target;
+        GLintptr source;          // offset in the staging buffer
+        GLintptr offset;
+        GLsizeiptr size;
+        const GpuHeap* heap;      // resolved into target/offset at Flush
+        GpuHeap::Handle block;
+        GLint level, x, y;
+        GLsizei width, height;
+        GLenum format, type;
+        GLsizeiptr rowBytes;
+        unsigned int sequence;    // submission order, wins over sorting when writes overlap
+    };
+
+    struct Segment
+    {
+        GLsync fence;
+        GLintptr end;
+        GLsizeiptr bytes;
+    };
+
+    void Submit(Request& request, const unsigned char* data);
+    // Stages as much of the request as budget and space allow; false when it could not finish.
+    bool Stage(Request& request, const unsigned char* data);
+    void ResolveHeapCopies();
+    void SortCopies();
+    void IssueCopies();
+    GLintptr Reserve(GLsizeiptr size);
+    void Reclaim();
+
+    GLuint staging = 0;
+    unsigned char* mapped = nullptr;
+    GLsizeiptr capacity = 0;
+    GLsizeiptr budget = 0;
+    GLsizeiptr budgetLeft = 0;
+
+    // ring: [tail, head) is in use, `used` disambiguates empty from full
+    GLintptr head = 0;
+    GLintptr tail = 0;
+    GLsizeiptr used = 0;
+    GLsizeiptr frameBytes = 0;
+    std::deque<Segment> segments;
+    bool starvedThisFrame = false;
+
+    std::deque<Request> pending;
+    std::vector<Copy> copies;
+
+    GLsizeiptr pendingBytes = 0;
+    unsigned long long bytesUploaded = 0;
+    unsigned int copiesLastFrame = 0;
+    unsigned int writesLastFrame = 0;
+    unsigned int writesThisFrame = 0;
+    unsigned int starved = 0;
+    double flushSeconds = 0.0;
+};
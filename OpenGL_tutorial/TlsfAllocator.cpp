@@ -0,0 +1,298 @@
+#include "TlsfAllocator.h"
+
+namespace
+{
+    uint32_t MostSignificantBit(uint64_t value)
+    {
+        uint32_t bit = 0;
+        while (value >>= 1)
+            ++bit;
+        return bit;
+    }
+
+    uint32_t LeastSignificantBit(uint32_t value)
+    {
+        uint32_t bit = 0;
+        while (!(value & 1))
+        {
+            value >>= 1;
+            ++bit;
+        }
+        return bit;
+    }
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint32_t granularity)
+{
+    Reset(capacity, granularity);
+}
+
+void TlsfAllocator::Reset(uint64_t newCapacity, uint32_t newGranularity)
+{
+    granularity = newGranularity;
+    capacity = newCapacity / granularity;
+    used = 0;
+    blocks.clear();
+    unusedBlocks.clear();
+    firstPhys = INVALID;
+    flBitmap = 0;
+    for (uint32_t fl = 0; fl < FL_COUNT; ++fl)
+    {
+        slBitmap[fl] = 0;
+        for (uint32_t sl = 0; sl < SL_COUNT; ++sl)
+            heads[fl][sl] = INVALID;
+    }
+
+    if (capacity == 0)
+        return;
+    uint32_t block = NewBlock();
+    blocks[block].offset = 0;
+    blocks[block].size = capacity;
+    firstPhys = block;
+    InsertFree(block);
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SL_COUNT)
+    {
+        fl = 0;
+        sl = (uint32_t)size;
+        return;
+    }
+    uint32_t msb = MostSignificantBit(size);
+    fl = msb - SL_BITS + 1;
+    sl = (uint32_t)(size >> (msb - SL_BITS)) - SL_COUNT;
+    if (fl >= FL_COUNT)
+    {
+        fl = FL_COUNT - 1;
+        sl = SL_COUNT - 1;
+    }
+}
+
+uint32_t TlsfAllocator::NewBlock()
+{
+    Block block = { 0, 0, 0, 0, INVALID, INVALID, INVALID, INVALID, true };
+    if (!unusedBlocks.empty())
+    {
+        uint32_t index = unusedBlocks.back();
+        unusedBlocks.pop_back();
+        blocks[index] = block;
+        return index;
+    }
+    blocks.push_back(block);
+    return (uint32_t)blocks.size() - 1;
+}
+
+void TlsfAllocator::InsertFree(uint32_t index)
+{
+    Block& block = blocks[index];
+    uint32_t fl, sl;
+    Mapping(block.size, fl, sl);
+    block.free = true;
+    block.prevFree = INVALID;
+    block.nextFree = heads[fl][sl];
+    if (block.nextFree != INVALID)
+        blocks[block.nextFree].prevFree = index;
+    heads[fl][sl] = index;
+    flBitmap |= 1u << fl;
+    slBitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t index)
+{
+    Block& block = blocks[index];
+    uint32_t fl, sl;
+    Mapping(block.size, fl, sl);
+    if (block.prevFree != INVALID)
+        blocks[block.prevFree].nextFree = block.nextFree;
+    else
+        heads[fl][sl] = block.nextFree;
+    if (block.nextFree != INVALID)
+        blocks[block.nextFree].prevFree = block.prevFree;
+
+    if (heads[fl][sl] == INVALID)
+    {
+        slBitmap[fl] &= ~(1u << sl);
+        if (slBitmap[fl] == 0)
+            flBitmap &= ~(1u << fl);
+    }
+    block.prevFree = block.nextFree = INVALID;
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size)
+{
+    // round up to the next class so any block found there is large enough
+    if (size >= SL_COUNT)
+        size += (1ull << (MostSignificantBit(size) - SL_BITS)) - 1;
+    uint32_t fl, sl;
+    Mapping(size, fl, sl);
+
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        uint32_t flMap = fl + 1 < FL_COUNT ? flBitmap & (~0u << (fl + 1)) : 0;
+        if (flMap == 0)
+            return INVALID;
+        fl = LeastSignificantBit(flMap);
+        slMap = slBitmap[fl];
+    }
+    sl = LeastSignificantBit(slMap);
+    return heads[fl][sl];
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    Allocation allocation;
+    uint64_t length = size == 0 ? 1 : (size + granularity - 1) / granularity;
+    uint64_t alignUnits = alignment > granularity ? (alignment + granularity - 1) / granularity : 1;
+    // slack for the worst-case padding, so the block stays valid wherever Compact moves it
+    uint64_t need = length + alignUnits - 1;
+
+    uint32_t index = FindFree(need);
+    if (index == INVALID)
+        return allocation;
+    RemoveFree(index);
+
+    if (blocks[index].size > need)
+    {
+        uint32_t rest = NewBlock();
+        Block& block = blocks[index];
+        blocks[rest].offset = block.offset + need;
+        blocks[rest].size = block.size - need;
+        blocks[rest].prevPhys = index;
+        blocks[rest].nextPhys = block.nextPhys;
+        if (block.nextPhys != INVALID)
+            blocks[block.nextPhys].prevPhys = rest;
+        block.nextPhys = rest;
+        block.size = need;
+        InsertFree(rest);
+    }
+
+    Block& block = blocks[index];
+    block.free = false;
+    block.length = length;
+    block.alignment = alignUnits;
+    used += block.size;
+
+    allocation.block = index;
+    allocation.offset = Offset(index);
+    return allocation;
+}
+
+uint64_t TlsfAllocator::Offset(uint32_t index) const
+{
+    const Block& block = blocks[index];
+    return AlignUp(block.offset, block.alignment) * granularity;
+}
+
+uint32_t TlsfAllocator::Merge(uint32_t index)
+{
+    uint32_t next = blocks[index].nextPhys;
+    if (next != INVALID && blocks[next].free)
+    {
+        RemoveFree(next);
+        blocks[index].size += blocks[next].size;
+        blocks[index].nextPhys = blocks[next].nextPhys;
+        if (blocks[next].nextPhys != INVALID)
+            blocks[blocks[next].nextPhys].prevPhys = index;
+        unusedBlocks.push_back(next);
+    }
+
+    uint32_t prev = blocks[index].prevPhys;
+    if (prev != INVALID && blocks[prev].free)
+    {
+        RemoveFree(prev);
+        blocks[prev].size += blocks[index].size;
+        blocks[prev].nextPhys = blocks[index].nextPhys;
+        if (blocks[index].nextPhys != INVALID)
+            blocks[blocks[index].nextPhys].prevPhys = prev;
+        unusedBlocks.push_back(index);
+        index = prev;
+    }
+    return index;
+}
+
+void TlsfAllocator::Free(uint32_t index)
+{
+    if (index == INVALID || blocks[index].free)
+        return;
+    used -= blocks[index].size;
+    blocks[index].free = true;
+    InsertFree(Merge(index));
+}
+
+std::vector<TlsfAllocator::Move> TlsfAllocator::Compact(uint64_t budget)
+{
+    std::vector<Move> moves;
+    uint64_t moved = 0;
+
+    uint32_t current = firstPhys;
+    while (current != INVALID && (moved < budget || moves.empty()))
+    {
+        uint32_t next = blocks[current].nextPhys;
+        if (!blocks[current].free || next == INVALID || blocks[next].free)
+        {
+            current = next;
+            continue;
+        }
+
+        // free block `current` followed by used block `next`: swap them
+        Block& hole = blocks[current];
+        Block& live = blocks[next];
+        uint64_t from = AlignUp(live.offset, live.alignment);
+        uint64_t to = AlignUp(hole.offset, live.alignment);
+        if (moved > 0 && moved + live.length * granularity > budget)
+            break;
+
+        RemoveFree(current);
+        live.offset = hole.offset;
+        hole.offset = live.offset + live.size;
+
+        uint32_t before = hole.prevPhys;
+        uint32_t after = live.nextPhys;
+        live.prevPhys = before;
+        live.nextPhys = current;
+        hole.prevPhys = next;
+        hole.nextPhys = after;
+        if (before != INVALID)
+            blocks[before].nextPhys = next;
+        else
+            firstPhys = next;
+        if (after != INVALID)
+            blocks[after].prevPhys = current;
+
+        if (from != to)
+        {
+            moves.push_back({ next, from * granularity, to * granularity, live.length * granularity });
+            moved += live.length * granularity;
+        }
+        current = Merge(current);
+        InsertFree(current);
+    }
+    return moves;
+}
+
+uint64_t TlsfAllocator::LargestFree() const
+{
+    uint64_t largest = 0;
+    for (uint32_t index = firstPhys; index != INVALID; index = blocks[index].nextPhys)
+    {
+        if (blocks[index].free && blocks[index].size > largest)
+            largest = blocks[index].size;
+    }
+    return largest * granularity;
+}
+
+double TlsfAllocator::Fragmentation() const
+{
+    uint64_t free = (capacity - used) * granularity;
+    if (free == 0)
+        return 0.0;
+    return 1.0 - (double)LargestFree() / (double)free;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract range of bytes (it never touches memory,
+// so it can manage GPU buffers). Allocation and free are O(1): the first level splits sizes by
+// power of two, the second level splits each power of two linearly into SL_COUNT classes, and
+// bitmaps find the first non-empty free list that is large enough.
+// Sizes and offsets are managed in units of `granularity` bytes.
+class TlsfAllocator
+{
+public:
+    static const uint32_t INVALID = 0xFFFFFFFF;
+
+    struct Allocation
+    {
+        uint32_t block = INVALID; // handle for Free / Offset
+        uint64_t offset = 0;      // bytes, aligned as requested
+    };
+
+    struct Move
+    {
+        uint32_t block;
+        uint64_t from;
+        uint64_t to;
+        uint64_t size;
+    };
+
+    explicit TlsfAllocator(uint64_t capacity = 0, uint32_t granularity = 16);
+    void Reset(uint64_t capacity, uint32_t granularity = 16);
+
+    // block == INVALID when no free range is large enough
+    Allocation Allocate(uint64_t size, uint64_t alignment = 0);
+    void Free(uint32_t block);
+    // Current (aligned) byte offset of a live allocation; changes when Compact moves it.
+    uint64_t Offset(uint32_t block) const;
+
+    // Slides live blocks down into the free space in front of them, at most `budget` bytes per
+    // call. The caller copies the data for each returned move, in order.
+    std::vector<Move> Compact(uint64_t budget);
+
+    uint64_t Capacity() const { return (uint64_t)capacity * granularity; }
+    uint64_t Used() const { return (uint64_t)used * granularity; }
+    uint64_t LargestFree() const;
+    // 0 when all free space is one block, towards 1 as it scatters
+    double Fragmentation() const;
+
+private:
+    static const uint32_t SL_BITS = 4;
+    static const uint32_t SL_COUNT = 1u << SL_BITS;
+    static const uint32_t FL_COUNT = 32;
+
+    struct Block
+    {
+        uint64_t offset;    // units
+        uint64_t size;      // units, including alignment slack
+        uint64_t length;    // units requested, used blocks only
+        uint64_t alignment; // units, used blocks only
+        uint32_t prevPhys, nextPhys;
+        uint32_t prevFree, nextFree;
+        bool free;
+    };
+
+    static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    uint32_t NewBlock();
+    void InsertFree(uint32_t block);
+    void RemoveFree(uint32_t block);
+    uint32_t FindFree(uint64_t size);
+    uint32_t Merge(uint32_t block);
+
+    uint32_t granularity = 16;
+    uint64_t capacity = 0; // units
+    uint64_t used = 0;     // units
+    std::vector<Block> blocks;
+    std::vector<uint32_t> unusedBlocks;
+    uint32_t firstPhys = INVALID;
+    uint32_t flBitmap = 0;
+    uint32_t slBitmap[FL_COUNT] = {};
+    uint32_t heads[FL_COUNT][SL_COUNT];
+};
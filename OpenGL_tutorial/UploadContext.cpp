@@ -0,0 +1,151 @@
+#include "UploadContext.h"
+
+#include "GLResources.h"
+
+#include <iostream>
+
+Upload::~Upload()
+{
+    // only set once submitted, and the loader holds a reference until then
+    if (fence)
+        glDeleteSync(fence);
+}
+
+UploadContext::~UploadContext()
+{
+    Stop();
+}
+
+bool UploadContext::Start(GLFWwindow* shareWith)
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "uploads", NULL, shareWith);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (context == NULL)
+    {
+        std::cout << "Failed to create upload context" << std::endl;
+        return false;
+    }
+
+    stopping = false;
+    thread = std::thread(&UploadContext::ThreadLoop, this);
+    return true;
+}
+
+void UploadContext::Stop()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+
+    glfwDestroyWindow(context);
+    context = nullptr;
+}
+
+UploadHandle UploadContext::Enqueue(Job job)
+{
+    UploadHandle upload = std::make_shared<Upload>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back({ std::move(job), upload });
+    }
+    wake.notify_one();
+    return upload;
+}
+
+UploadHandle UploadContext::UploadBuffer(std::vector<unsigned char> data)
+{
+    return Enqueue([data = std::move(data)]() {
+        GLuint buffer;
+        if (DirectStateAccessSupported())
+        {
+            glCreateBuffers(1, &buffer);
+            glNamedBufferStorage(buffer, data.size(), data.data(), 0);
+            return buffer;
+        }
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    });
+}
+
+UploadHandle UploadContext::UploadTexture(int width, int height, std::vector<unsigned char> rgba)
+{
+    return Enqueue([width, height, rgba = std::move(rgba)]() {
+        GLuint texture;
+        if (DirectStateAccessSupported())
+        {
+            glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+            glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+            glTextureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+            glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            return texture;
+        }
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    });
+}
+
+bool UploadContext::IsReady(Upload& upload)
+{
+    if (upload.ready)
+        return true;
+    if (!upload.submitted.load(std::memory_order_acquire))
+        return false;
+
+    GLenum status = glClientWaitSync(upload.fence, 0, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+    {
+        glDeleteSync(upload.fence);
+        upload.fence = nullptr;
+        upload.ready = true;
+    }
+    return upload.ready;
+}
+
+size_t UploadContext::Pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+void UploadContext::ThreadLoop()
+{
+    glfwMakeContextCurrent(context);
+    // rows of tightly packed RGBA8 are always 4-byte aligned, but jobs may upload other formats
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                break;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task.upload->object = task.job();
+        task.upload->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // the fence has to reach the server before another context can wait on it
+        glFlush();
+        task.upload->submitted.store(true, std::memory_order_release);
+    }
+
+    glfwMakeContextCurrent(NULL);
+}
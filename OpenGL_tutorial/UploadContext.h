@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One background upload. The upload thread fills in the object and fence; the render thread
+// polls it through UploadContext::IsReady and must not touch the object before that returns true.
+struct Upload
+{
+    // Deletes a fence IsReady never got to; needs a context of the share group to be current.
+    ~Upload();
+
+    GLuint object = 0;
+    GLsync fence = nullptr;
+    std::atomic<bool> submitted{ false };
+    bool ready = false; // render thread only
+};
+
+typedef std::shared_ptr<Upload> UploadHandle;
+
+// Hidden GLFW context, shared with the resource context, owned by a loader thread.
+// Each upload ends with glFenceSync + glFlush so the render thread can test completion with
+// a zero-timeout glClientWaitSync instead of stalling the frame.
+// The loader context never draws and has no GLStateCache (GLState() belongs to the render
+// thread); the built-in uploads create and fill objects through DSA and only fall back to
+// binding on this private context when DSA is missing.
+class UploadContext
+{
+public:
+    typedef std::function<GLuint()> Job;
+
+    ~UploadContext();
+
+    // Creates the hidden context (main thread only, GLFW requirement) and starts the thread.
+    bool Start(GLFWwindow* shareWith);
+    // Finishes the queued uploads and joins the thread.
+    void Stop();
+
+    // The job runs on the upload thread with the upload context current and returns the
+    // name of the object it created.
+    UploadHandle Enqueue(Job job);
+    UploadHandle UploadBuffer(std::vector<unsigned char> data);
+    UploadHandle UploadTexture(int width, int height, std::vector<unsigned char> rgba);
+
+    // Non-blocking; call on the render thread. Objects become usable once this returns true,
+    // bind them again on the render context to pick up the new contents.
+    static bool IsReady(Upload& upload);
+
+    size_t Pending();
+
+private:
+    struct Task
+    {
+        Job job;
+        UploadHandle upload;
+    };
+
+    void ThreadLoop();
+
+    GLFWwindow* context = nullptr;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Task> tasks;
+    bool stopping = false;
+};
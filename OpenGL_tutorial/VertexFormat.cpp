@@ -0,0 +1,213 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    const GLsizei FLOAT32_STRIDE = 48;
+    const GLsizei COMPRESSED_STRIDE = 20;
+
+    // Compressed layout: unorm16 x4 position (w unused, keeps the next attribute 4-byte aligned),
+    // 2_10_10_10 normal, 2_10_10_10 tangent, half2 uv
+    const GLuint COMPRESSED_NORMAL_OFFSET = 8;
+    const GLuint COMPRESSED_TANGENT_OFFSET = 12;
+    const GLuint COMPRESSED_UV_OFFSET = 16;
+
+    int32_t SignExtend10(uint32_t bits)
+    {
+        return (int32_t)(bits << 22) >> 22;
+    }
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent == 0xFF)
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // infinity or NaN
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 31)
+        return (uint16_t)(sign | 0x7C00);
+    if (halfExponent <= 0)
+    {
+        // subnormal half, or zero below half the smallest subnormal
+        if (halfExponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000;
+        int shift = 14 - halfExponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    // round to nearest even; a carry out of the mantissa correctly bumps the exponent
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return (uint16_t)(sign | half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    if (exponent == 0)
+    {
+        float magnitude = std::ldexp((float)mantissa, -24);
+        return sign ? -magnitude : magnitude;
+    }
+    uint32_t bits = exponent == 31
+        ? sign | 0x7F800000 | (mantissa << 13)
+        : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+uint32_t PackSnorm2101010(const float value[4])
+{
+    uint32_t packed = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        int32_t component = (int32_t)std::lround(std::min(std::max(value[i], -1.0f), 1.0f) * 511.0f);
+        packed |= ((uint32_t)component & 0x3FF) << (i * 10);
+    }
+    int32_t w = (int32_t)std::lround(std::min(std::max(value[3], -1.0f), 1.0f));
+    packed |= ((uint32_t)w & 0x3) << 30;
+    return packed;
+}
+
+void UnpackSnorm2101010(uint32_t packed, float value[4])
+{
+    // GL 4.2 signed normalized conversion: c / (2^(b-1) - 1), clamped to -1
+    for (int i = 0; i < 3; ++i)
+        value[i] = std::max((float)SignExtend10((packed >> (i * 10)) & 0x3FF) / 511.0f, -1.0f);
+    value[3] = std::max((float)((int32_t)packed >> 30), -1.0f);
+}
+
+GLsizei VertexStride(VertexFormat format)
+{
+    return format == VertexFormat::Compressed ? COMPRESSED_STRIDE : FLOAT32_STRIDE;
+}
+
+PackedMesh PackVertices(const MeshVertex* vertices, GLsizei count, VertexFormat format)
+{
+    PackedMesh mesh;
+    mesh.format = format;
+    mesh.stride = VertexStride(format);
+    mesh.vertexCount = count;
+    mesh.vertices.resize((size_t)count * mesh.stride);
+
+    if (format == VertexFormat::Float32)
+    {
+        static_assert(sizeof(MeshVertex) == FLOAT32_STRIDE, "MeshVertex is the fp32 layout");
+        memcpy(mesh.vertices.data(), vertices, mesh.vertices.size());
+        return mesh;
+    }
+
+    float boundsMax[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mesh.boundsMin[axis] = count > 0 ? vertices[0].position[axis] : 0.0f;
+        boundsMax[axis] = mesh.boundsMin[axis];
+    }
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], vertices[i].position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], vertices[i].position[axis]);
+        }
+    }
+    float scale[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mesh.boundsExtent[axis] = boundsMax[axis] - mesh.boundsMin[axis];
+        scale[axis] = mesh.boundsExtent[axis] > 0.0f ? 65535.0f / mesh.boundsExtent[axis] : 0.0f;
+    }
+
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        const MeshVertex& vertex = vertices[i];
+        unsigned char* out = mesh.vertices.data() + (size_t)i * COMPRESSED_STRIDE;
+
+        uint16_t position[4] = {};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float quantized = (vertex.position[axis] - mesh.boundsMin[axis]) * scale[axis];
+            position[axis] = (uint16_t)std::lround(std::min(std::max(quantized, 0.0f), 65535.0f));
+        }
+        const float normal[4] = { vertex.normal[0], vertex.normal[1], vertex.normal[2], 0.0f };
+        uint32_t packedNormal = PackSnorm2101010(normal);
+        uint32_t packedTangent = PackSnorm2101010(vertex.tangent);
+        uint16_t uv[2] = { FloatToHalf(vertex.uv[0]), FloatToHalf(vertex.uv[1]) };
+
+        memcpy(out, position, sizeof(position));
+        memcpy(out + COMPRESSED_NORMAL_OFFSET, &packedNormal, sizeof(packedNormal));
+        memcpy(out + COMPRESSED_TANGENT_OFFSET, &packedTangent, sizeof(packedTangent));
+        memcpy(out + COMPRESSED_UV_OFFSET, uv, sizeof(uv));
+    }
+    return mesh;
+}
+
+MeshVertex UnpackVertex(const PackedMesh& mesh, GLsizei index)
+{
+    MeshVertex vertex;
+    const unsigned char* in = mesh.vertices.data() + (size_t)index * mesh.stride;
+    if (mesh.format == VertexFormat::Float32)
+    {
+        memcpy(&vertex, in, sizeof(vertex));
+        return vertex;
+    }
+
+    uint16_t position[4];
+    uint32_t packedNormal;
+    uint32_t packedTangent;
+    uint16_t uv[2];
+    memcpy(position, in, sizeof(position));
+    memcpy(&packedNormal, in + COMPRESSED_NORMAL_OFFSET, sizeof(packedNormal));
+    memcpy(&packedTangent, in + COMPRESSED_TANGENT_OFFSET, sizeof(packedTangent));
+    memcpy(uv, in + COMPRESSED_UV_OFFSET, sizeof(uv));
+
+    for (int axis = 0; axis < 3; ++axis)
+        vertex.position[axis] = mesh.boundsMin[axis] + position[axis] / 65535.0f * mesh.boundsExtent[axis];
+    float normal[4];
+    UnpackSnorm2101010(packedNormal, normal);
+    std::copy(normal, normal + 3, vertex.normal);
+    UnpackSnorm2101010(packedTangent, vertex.tangent);
+    vertex.uv[0] = HalfToFloat(uv[0]);
+    vertex.uv[1] = HalfToFloat(uv[1]);
+    return vertex;
+}
+
+void SetupVertexFormat(VertexArray& vertexArray, GLuint binding, const Buffer& buffer, const PackedMesh& mesh)
+{
+    vertexArray.SetVertexBuffer(binding, buffer, 0, mesh.stride);
+    if (mesh.format == VertexFormat::Float32)
+    {
+        vertexArray.SetAttribute(POSITION_ATTRIBUTE, binding, 3, GL_FLOAT, GL_FALSE, offsetof(MeshVertex, position));
+        vertexArray.SetAttribute(NORMAL_ATTRIBUTE, binding, 3, GL_FLOAT, GL_FALSE, offsetof(MeshVertex, normal));
+        vertexArray.SetAttribute(TANGENT_ATTRIBUTE, binding, 4, GL_FLOAT, GL_FALSE, offsetof(MeshVertex, tangent));
+        vertexArray.SetAttribute(UV_ATTRIBUTE, binding, 2, GL_FLOAT, GL_FALSE, offsetof(MeshVertex, uv));
+        return;
+    }
+
+    // packed types need size 4; the normal's w is zero
+    vertexArray.SetAttribute(POSITION_ATTRIBUTE, binding, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0);
+    vertexArray.SetAttribute(NORMAL_ATTRIBUTE, binding, 4, GL_INT_2_10_10_10_REV, GL_TRUE, COMPRESSED_NORMAL_OFFSET);
+    vertexArray.SetAttribute(TANGENT_ATTRIBUTE, binding, 4, GL_INT_2_10_10_10_REV, GL_TRUE, COMPRESSED_TANGENT_OFFSET);
+    vertexArray.SetAttribute(UV_ATTRIBUTE, binding, 2, GL_HALF_FLOAT, GL_FALSE, COMPRESSED_UV_OFFSET);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "GLResources.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// Vertex as loaded or generated, before packing.
+struct MeshVertex
+{
+    float position[3];
+    float normal[3];
+    float tangent[4]; // w is the bitangent sign
+    float uv[2];
+};
+
+// Float32: 48 bytes per vertex, everything fp32.
+// Compressed: 20 bytes per vertex. Positions are 16-bit unorm inside the mesh's bounding box,
+// normals and tangents GL_INT_2_10_10_10_REV snorm, UVs half floats. Everything except the
+// position is decoded by the vertex fetch; the position needs boundsMin + value * boundsExtent
+// in the shader (shaders/packed_mesh.vert), which is an identity for Float32 meshes.
+enum class VertexFormat
+{
+    Float32,
+    Compressed,
+};
+
+// attribute locations; 4 is RenderQueue::INSTANCE_ATTRIBUTE
+const GLuint POSITION_ATTRIBUTE = 0;
+const GLuint NORMAL_ATTRIBUTE = 1;
+const GLuint TANGENT_ATTRIBUTE = 2;
+const GLuint UV_ATTRIBUTE = 3;
+
+struct PackedMesh
+{
+    VertexFormat format = VertexFormat::Float32;
+    std::vector<unsigned char> vertices;
+    GLsizei stride = 0;
+    GLsizei vertexCount = 0;
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsExtent[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+GLsizei VertexStride(VertexFormat format);
+PackedMesh PackVertices(const MeshVertex* vertices, GLsizei count, VertexFormat format);
+// CPU decode, the same conversions the vertex fetch applies.
+MeshVertex UnpackVertex(const PackedMesh& mesh, GLsizei index);
+
+// Points the vertex array at `buffer` (holding mesh.vertices) through glVertexAttribFormat /
+// glVertexAttribBinding on vertex buffer binding `binding`.
+void SetupVertexFormat(VertexArray& vertexArray, GLuint binding, const Buffer& buffer, const PackedMesh& mesh);
+
+// scalar encodings
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+uint32_t PackSnorm2101010(const float value[4]);
+void UnpackSnorm2101010(uint32_t packed, float value[4]);
@@ -0,0 +1,124 @@
+#include "WindowManager.h"
+
+#include "DebugOutput.h"
+#include "GLStateCache.h"
+
+#include <iostream>
+
+bool SetActiveWindow(GLFWwindow* window)
+{
+    bool success = true;
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        success = false;
+    }
+    if (glfwGetCurrentContext() != window)
+    {
+        glfwMakeContextCurrent(window);
+        SelectStateCache(window);
+    }
+    return success;
+}
+
+WindowManager::~WindowManager()
+{
+    Destroy();
+}
+
+void WindowManager::Destroy()
+{
+    for (Entry& entry : windows)
+        CloseContext(entry.handle);
+    windows.clear();
+    if (resourceContext)
+        CloseContext(resourceContext);
+    resourceContext = nullptr;
+}
+
+void WindowManager::CloseWindow(size_t index)
+{
+    CloseContext(windows[index].handle);
+    windows.erase(windows.begin() + index);
+}
+
+void WindowManager::CloseContext(GLFWwindow* window)
+{
+    // the debug callback is per context and has to go before the context does
+    glfwMakeContextCurrent(window);
+    SelectStateCache(window);
+    DebugOutput::Uninstall();
+    glfwMakeContextCurrent(NULL);
+    SelectStateCache(NULL);
+    ReleaseStateCache(window);
+    glfwDestroyWindow(window);
+}
+
+GLFWwindow* WindowManager::CreateResourceContext()
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    resourceContext = glfwCreateWindow(1, 1, "resources", NULL, NULL);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    return resourceContext;
+}
+
+GLFWwindow* WindowManager::OpenWindow(int width, int height, const char* title, bool visible)
+{
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, resourceContext);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (window == NULL)
+        return NULL;
+
+    // with several windows only the last one waits for vblank, otherwise every swap
+    // would block and the frame rate would divide by the window count
+    GLFWwindow* previous = glfwGetCurrentContext();
+    if (!windows.empty())
+    {
+        glfwMakeContextCurrent(windows.back().handle);
+        glfwSwapInterval(0);
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(1);
+    glfwMakeContextCurrent(previous);
+
+    windows.push_back({ window, {} });
+    return window;
+}
+
+bool WindowManager::ShouldClose() const
+{
+    for (const Entry& entry : windows)
+    {
+        if (glfwWindowShouldClose(entry.handle))
+            return true;
+    }
+    return windows.empty();
+}
+
+void WindowManager::Submit(size_t index, Job job)
+{
+    windows[index].jobs.push_back(std::move(job));
+}
+
+void WindowManager::SubmitAll(const Job& job)
+{
+    for (Entry& entry : windows)
+        entry.jobs.push_back(job);
+}
+
+void WindowManager::Flush()
+{
+    contextSwitches = 0;
+    for (Entry& entry : windows)
+    {
+        if (glfwGetCurrentContext() != entry.handle)
+            contextSwitches++;
+        SetActiveWindow(entry.handle);
+        for (Job& job : entry.jobs)
+            job(entry.handle);
+        entry.jobs.clear();
+        glfwSwapBuffers(entry.handle);
+    }
+}
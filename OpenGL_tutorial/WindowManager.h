@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <vector>
+
+// Makes the window's context current, skipping the call if it already is.
+bool SetActiveWindow(GLFWwindow* window);
+
+// A set of display windows sharing one hidden resource context.
+// Buffers, textures, shaders and programs are uploaded once on the resource context and are
+// visible from every window. Container objects (VAOs, FBOs, program pipelines) are not shared
+// by GL and must be created per window.
+// Work is queued per window and flushed once per frame, so each context is made current at
+// most once per frame no matter how much work was submitted to it.
+class WindowManager
+{
+public:
+    typedef std::function<void(GLFWwindow*)> Job;
+
+    ~WindowManager();
+    // Destroys every window; must run before glfwTerminate.
+    void Destroy();
+
+    // Hidden context that owns shared resources. Create it first and load GLAD on it.
+    GLFWwindow* CreateResourceContext();
+    GLFWwindow* OpenWindow(int width, int height, const char* title, bool visible);
+    // Uninstalls the context's debug callback and destroys the window; leaves no context current.
+    void CloseWindow(size_t index);
+
+    GLFWwindow* ResourceContext() const { return resourceContext; }
+    size_t WindowCount() const { return windows.size(); }
+    GLFWwindow* Window(size_t index) const { return windows[index].handle; }
+    bool ShouldClose() const;
+
+    void Submit(size_t index, Job job);
+    // Submits the same job to every window.
+    void SubmitAll(const Job& job);
+    // Runs the queued work context by context and presents every window.
+    void Flush();
+
+    unsigned int ContextSwitchesLastFrame() const { return contextSwitches; }
+
+private:
+    void CloseContext(GLFWwindow* window);
+
+    struct Entry
+    {
+        GLFWwindow* handle;
+        std::vector<Job> jobs;
+    };
+
+    GLFWwindow* resourceContext = nullptr;
+    std::vector<Entry> windows;
+    unsigned int contextSwitches = 0;
+};
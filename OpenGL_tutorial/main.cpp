@@ -3,36 +3,302 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "ContextConfig.h"
+#include "AsyncProgramBuilder.h"
+#include "ComputePass.h"
+#include "DebugOutput.h"
+#include "DisplayConfig.h"
+#include "DynamicBufferRing.h"
+#include "GLResources.h"
+#include "GLStateCache.h"
+#include "GpuHeap.h"
+#include "GpuScene.h"
+#include "ParallelRecorder.h"
+#include "ProgramPipelines.h"
+#include "ProgramBinaryCache.h"
+#include "Shader.h"
+#include "RenderQueue.h"
+#include "ShaderHotReload.h"
+#include "ShaderPermutations.h"
+#include "ShaderReflection.h"
+#include "SpirvShader.h"
+#include "StagingUploader.h"
+#include "UploadContext.h"
+#include "VertexFormat.h"
+#include "WindowManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void content_scale_callback(GLFWwindow* window, float xscale, float yscale);
 void processInput(GLFWwindow* window);
-bool SetActiveWindow(GLFWwindow* window);
+void RunDebugOutputSelfTest(int repeats);
+bool RunStateCacheSelfTest();
+void RunSubmissionBenchmark(int draws, ContextMode restoreMode);
+void RunAssetStreamingBenchmark(GLFWwindow* window, UploadContext& uploads, int megabytes);
+void RunProgramCacheBenchmark(int programs);
+void RunProgramBuildBenchmark(int programs);
+void RunSpirvBenchmark(int repeats);
+void RunPreprocessBenchmark(int shaders);
+void RunUniformBenchmark(int frames);
+void RunComputeBenchmark(int dispatches);
+void RunDynamicBufferBenchmark(int frames);
+void RunHeapChurnBenchmark(int operations);
+void RunResourceBenchmark(int count, bool countCalls);
+void RunRecordingBenchmark(int objects);
+void RunVertexFormatBenchmark(int vertices);
+void RecordQueueBenchmark(RenderQueue& queue, int count, GLuint program, const std::vector<VertexArray>& vertexArrays);
+void BuildGpuSceneBenchmark(GpuScene& scene, int objects);
+void CreateForestMeshes(Buffer& vertices, Buffer& indices, VertexArray& vertexArray, const DynamicBufferRing& instances);
+void RecordForestBenchmark(RenderQueue& queue, int trees, GLuint program, const VertexArray& vertexArray);
+void PerspectiveMatrix(float aspect, float nearPlane, float farPlane, float matrix[16]);
+float WindowAspect(GLFWwindow* window);
+
+// --permutations: a cube for every feature combination of the uber shader; the buffers and
+// textures are shared, the vertex array belongs to the first window
+struct PermutationScene
+{
+    Buffer vertices;
+    Buffer indices;
+    Buffer instances;
+    Buffer boneWeights;
+    Buffer bones;
+    Texture normalMap;
+    Texture shadowMap;
+    VertexArray vertexArray;
+};
+
+void CreatePermutationScene(PermutationScene& scene);
+void DrawPermutationScene(PermutationScene& scene, ShaderPermutations& permutations, float aspect);
+
+// --material-matrix / --pipeline-bench: MATRIX_SIZE geometry variants (vertex stages) by
+// MATRIX_SIZE material variants (fragment stages), one quad per combination. Separable, every
+// stage is built once and each cell is a program pipeline; monolithic, each cell is a program
+// of its own. The vertex array and the pipelines belong to the context that created the matrix
+const int MATRIX_SIZE = 20;
+
+struct MaterialMatrix
+{
+    bool separable = true;
+    std::unique_ptr<ProgramPipelines> pipelines;
+    std::vector<GLuint> vertexStages;
+    std::vector<GLuint> fragmentStages;
+    std::vector<GLuint> programs; // monolithic, geometry * MATRIX_SIZE + material
+    Buffer vertices;
+    VertexArray vertexArray;
+    double buildMilliseconds = 0.0;
+    long long programBytes = 0;          // GL_PROGRAM_BINARY_LENGTH over every program
+    long long videoMemoryKilobytes = -1; // NVX_gpu_memory_info, -1 where unavailable
+};
+
+bool CreateMaterialMatrix(MaterialMatrix& matrix, bool separable);
+void DrawMaterialMatrix(MaterialMatrix& matrix, GLStateCache& state);
+void ReleaseMaterialMatrix(MaterialMatrix& matrix);
+void ReportMaterialMatrix(const MaterialMatrix& matrix);
+void RunPipelineBenchmark(int frames);
 
 // settings
 const unsigned int SCREEN_WIDTH = 1920;
 const unsigned int SCREEN_HEIGTH = 1080;
 
-int main()
-{
+DisplayConfig display;
 
+int main(int argc, char** argv)
+{
+    // command line: --windows N opens N windows sharing one resource context,
+    // --hidden keeps them invisible (headless runs, which stop after 600 frames unless limited otherwise),
+    // --frames N and --seconds S close every window after N frames or S seconds and print the run's report,
+    // --render-scale S renders at S times the logical resolution,
+    // --max-pixels N caps the internal resolution (default SCREEN_WIDTH * SCREEN_HEIGTH),
+    // --spirv loads the precompiled SPIR-V shaders (tools/compile_shaders.sh) instead of GLSL,
+    // --stream MB keeps streaming an MB-sized asset through the staging uploader and reports throughput
+    // when the run ends (600 frames unless --frames or --seconds say otherwise),
+    // --resource-bench N times building and updating N buffers, textures and vertex arrays,
+    // --count-gl-calls counts the state calls that reach the driver and checks none bypassed the cache,
+    // --queue-bench N records, sorts and executes N synthetic draws per frame through the render queue
+    // and reports the times when the run ends (bounded like --stream),
+    // --record-bench N times recording an N-object scene on 1 to all hardware threads,
+    // --gpu-scene N culls and draws N objects on the GPU with one multi-draw indirect per frame and
+    // reports the CPU submission time when the run ends (bounded like --stream),
+    // --per-object-draws draws the --gpu-scene objects one call each instead (CPU culled),
+    // --forest N submits N trees (trunk and crown) per frame through the render queue, merged into
+    // instanced draws; with --no-instancing every tree part stays a draw of its own; reports draws and
+    // frame time when the run ends (bounded like --stream),
+    // --vertex-format-bench N checks the packed vertex format's error bounds on N vertices and
+    // compares its size and fetch time with fp32,
+    // --state-cache-selftest drives the state cache against counting stubs instead of a driver and
+    // checks exactly which calls got through,
+    // --debug-selftest N provokes N known GL errors and performance messages and checks the debug
+    // output pipeline aggregated and counted all of them,
+    // --submit-bench N times submitting N draws in a no-error and in a validating context,
+    // --stream-assets MB uploads MB of textures and buffers while rendering, once from the render
+    // thread and once through the loader thread, and compares the frame time spikes,
+    // --cache-bench N builds N program variants with an empty and then with a warm binary cache,
+    // --build-bench N builds N programs through the async builder, serially and in parallel,
+    // --spirv-bench N builds every shader program N times from GLSL and from its SPIR-V module,
+    // --ring-bench N streams 4 MB of dynamic data a frame for N frames through the mapped ring,
+    // glBufferSubData and buffer orphaning and compares their MB/s,
+    // --heap-bench N allocates and frees N random sized blocks in a 64 MB GPU heap, without and
+    // with compaction, and reports allocation latency and fragmentation,
+    // --compute-bench N checks the compute scheduler's barriers on a small pass chain, then times N
+    // dependent and N independent dispatches with its barriers and with full barriers,
+    // --uniform-bench N sets 10k uniforms a frame for N frames, by name and through reflection,
+    // --preprocess-bench N expands a generated corpus of N shaders and their includes and reports
+    // the preprocessor's throughput,
+    // --permutations draws every variant of the uber shader each frame and reports the frames that
+    // stalled on a variant compile; variants used before are pre-warmed from the binary cache,
+    // --material-matrix draws 20 geometry by 20 material shader variants each frame through program
+    // pipelines; with --monolithic every combination is linked into a program of its own,
+    // --pipeline-bench N builds that matrix both ways and compares startup time, program memory
+    // and the cost of drawing it N times
+    int windowCount = 1;
+    bool permutationDemo = false;
+    bool materialMatrixDemo = false;
+    bool separableMatrix = true;
+    int pipelineBenchCount = 0;
+    int spirvBenchCount = 0;
+    int preprocessBenchCount = 0;
+    int uniformBenchCount = 0;
+    int computeBenchCount = 0;
+    int ringBenchCount = 0;
+    int heapBenchCount = 0;
+    int buildBenchCount = 0;
+    int cacheBenchCount = 0;
+    int streamAssetsMegabytes = 0;
+    int debugSelfTestCount = 0;
+    bool stateCacheSelfTest = false;
+    int submitBenchCount = 0;
+    int recordBenchCount = 0;
+    int resourceBenchCount = 0;
+    int vertexFormatBenchCount = 0;
+    int queueBenchCount = 0;
+    int gpuSceneCount = 0;
+    bool perObjectDraws = false;
+    int forestCount = 0;
+    bool instancing = true;
+    bool countCalls = false;
+    GLsizeiptr streamBytes = 0;
+    bool visible = true;
+    int frameLimit = 0;
+    double secondsLimit = 0.0;
+    bool useSpirv = false;
+    RenderScaleSettings renderScale;
+    renderScale.maxPixels = (long long)SCREEN_WIDTH * SCREEN_HEIGTH;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc)
+            windowCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hidden") == 0)
+            visible = false;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frameLimit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            secondsLimit = atof(argv[++i]);
+        else if (strcmp(argv[i], "--spirv") == 0)
+            useSpirv = true;
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+            streamBytes = (GLsizeiptr)(atof(argv[++i]) * 1024 * 1024);
+        else if (strcmp(argv[i], "--resource-bench") == 0 && i + 1 < argc)
+            resourceBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--vertex-format-bench") == 0 && i + 1 < argc)
+            vertexFormatBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--queue-bench") == 0 && i + 1 < argc)
+            queueBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--record-bench") == 0 && i + 1 < argc)
+            recordBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--gpu-scene") == 0 && i + 1 < argc)
+            gpuSceneCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--per-object-draws") == 0)
+            perObjectDraws = true;
+        else if (strcmp(argv[i], "--forest") == 0 && i + 1 < argc)
+            forestCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-instancing") == 0)
+            instancing = false;
+        else if (strcmp(argv[i], "--count-gl-calls") == 0)
+            countCalls = true;
+        else if (strcmp(argv[i], "--debug-selftest") == 0 && i + 1 < argc)
+            debugSelfTestCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--state-cache-selftest") == 0)
+            stateCacheSelfTest = true;
+        else if (strcmp(argv[i], "--submit-bench") == 0 && i + 1 < argc)
+            submitBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stream-assets") == 0 && i + 1 < argc)
+            streamAssetsMegabytes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache-bench") == 0 && i + 1 < argc)
+            cacheBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--build-bench") == 0 && i + 1 < argc)
+            buildBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--spirv-bench") == 0 && i + 1 < argc)
+            spirvBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ring-bench") == 0 && i + 1 < argc)
+            ringBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--heap-bench") == 0 && i + 1 < argc)
+            heapBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--compute-bench") == 0 && i + 1 < argc)
+            computeBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--uniform-bench") == 0 && i + 1 < argc)
+            uniformBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--preprocess-bench") == 0 && i + 1 < argc)
+            preprocessBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--permutations") == 0)
+            permutationDemo = true;
+        else if (strcmp(argv[i], "--material-matrix") == 0)
+            materialMatrixDemo = true;
+        else if (strcmp(argv[i], "--monolithic") == 0)
+            separableMatrix = false;
+        else if (strcmp(argv[i], "--pipeline-bench") == 0 && i + 1 < argc)
+            pipelineBenchCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc)
+        {
+            renderScale.policy = RenderScalePolicy::FixedScale;
+            renderScale.scale = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-pixels") == 0 && i + 1 < argc)
+        {
+            renderScale.policy = RenderScalePolicy::CappedPixels;
+            renderScale.maxPixels = atoll(argv[++i]);
+        }
+    }
+    display.SetSettings(renderScale);
+    // hidden windows can't be closed, and the report only prints once the loop ends; runs that
+    // measure the loop end by themselves too
+    bool boundedRun = !visible || streamBytes > 0 || queueBenchCount > 0 || gpuSceneCount > 0 || forestCount > 0;
+    if (boundedRun && frameLimit <= 0 && secondsLimit <= 0.0)
+        frameLimit = 600;
 
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    // recording and preprocessing never touch GL, so they are measured before any context exists;
+    // the state cache self-test replaces the driver itself
+    if (stateCacheSelfTest && !RunStateCacheSelfTest())
         return -1;
-    }
+    if (recordBenchCount > 0)
+        RunRecordingBenchmark(recordBenchCount);
+    if (preprocessBenchCount > 0)
+        RunPreprocessBenchmark(preprocessBenchCount);
+    ContextMode contextMode = ParseContextMode(argc, argv);
+    ApplyContextHints(contextMode);
+    DisplayConfig::ApplyWindowHints();
 
-    glfwMakeContextCurrent(window);
+    WindowManager windows;
+    GLFWwindow* resourceContext = windows.CreateResourceContext();
+    if (!SetActiveWindow(resourceContext))
+        return -1;
 
     // GLAD init
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -41,17 +307,436 @@ int main()
         return -1;
     }
 
+    contextMode = ConfigureContext(resourceContext, contextMode);
+    std::cout << "OpenGL context: " << ContextModeName(contextMode) << std::endl;
+    if (debugSelfTestCount > 0)
+    {
+        if (contextMode == ContextMode::Validating)
+            RunDebugOutputSelfTest(debugSelfTestCount);
+        else
+            std::cout << "Debug output self-test needs a validating context (--debug-context)" << std::endl;
+    }
+    if (submitBenchCount > 0)
+    {
+        RunSubmissionBenchmark(submitBenchCount, contextMode);
+        SetActiveWindow(resourceContext);
+    }
+    if (countCalls)
+        CountDriverCalls();
+    if (resourceBenchCount > 0)
+        RunResourceBenchmark(resourceBenchCount, countCalls);
+    if (vertexFormatBenchCount > 0)
+        RunVertexFormatBenchmark(vertexFormatBenchCount);
+    if (cacheBenchCount > 0)
+        RunProgramCacheBenchmark(cacheBenchCount);
+    if (buildBenchCount > 0)
+        RunProgramBuildBenchmark(buildBenchCount);
+    if (spirvBenchCount > 0)
+        RunSpirvBenchmark(spirvBenchCount);
+    if (pipelineBenchCount > 0)
+        RunPipelineBenchmark(pipelineBenchCount);
+    if (uniformBenchCount > 0)
+        RunUniformBenchmark(uniformBenchCount);
+    if (computeBenchCount > 0)
+        RunComputeBenchmark(computeBenchCount);
+    if (ringBenchCount > 0)
+        RunDynamicBufferBenchmark(ringBenchCount);
+    if (heapBenchCount > 0)
+        RunHeapChurnBenchmark(heapBenchCount);
+
+    // shared resources are uploaded once, on the resource context or by the loader thread;
+    // the render loop only uses an upload after UploadContext::IsReady reports its fence signalled
+    UploadContext uploads;
+    if (!uploads.Start(resourceContext))
+        return -1;
+
+    // shaders: restored from the program binary cache when possible, otherwise compiled in the
+    // background while the render loop keeps running
+    ProgramBinaryCache shaderCache("shader_cache");
+    shaderCache.Init();
+    AsyncProgramBuilder shaderBuilder;
+    shaderBuilder.Init(&shaderCache);
+    double shaderStart = glfwGetTime();
+    // built up front and drawn with until a program has linked (or if it fails to)
+    GLuint fallbackProgram = shaderCache.GetOrBuild(LoadProgramSource("fallback", "shaders/fallback.vert", "shaders/fallback.frag"));
+    const float identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+    if (fallbackProgram != 0)
+        glProgramUniformMatrix4fv(fallbackProgram, 0, 1, GL_FALSE, identity);
+    ShaderHotReload shaderReload("shaders");
+    AsyncProgramHandle basicProgram;
+    if (useSpirv && SpirvSupported())
+    {
+        basicProgram = std::make_shared<AsyncProgram>();
+        basicProgram->name = "basic";
+        basicProgram->fallback = fallbackProgram;
+        basicProgram->program = BuildSpirvProgram({
+            { GL_VERTEX_SHADER, SpirvModulePath("VertexShader.vert.spv"), "main", {} },
+            { GL_FRAGMENT_SHADER, SpirvModulePath("basic.frag.spv"), "main", {} } }, "basic");
+        basicProgram->ready = basicProgram->program != 0;
+        basicProgram->failed = !basicProgram->ready;
+    }
+    else
+    {
+        // edits to the GLSL shaders are picked up without restarting
+        shaderReload.Start();
+        basicProgram = shaderReload.Load(shaderBuilder, { "basic", "basic.vert", "basic.frag", "", {} }, fallbackProgram);
+    }
+    bool shadersReported = false;
+
+    // per-frame uniforms and instance data are streamed through a persistently mapped ring
+    // (plus room for the forest's instance data)
+    DynamicBufferRing frameData;
+    if (!frameData.Create(4 * 1024 * 1024 + (GLsizeiptr)forestCount * 2 * RenderQueue::INSTANCE_STRIDE))
+        return -1;
+
+    // long-lived vertex, index and uniform data shares one buffer, compacted a little every frame
+    GpuHeap meshHeap;
+    if (!meshHeap.Create(64 * 1024 * 1024))
+        return -1;
+
+    // writes into existing buffers and textures go through a fenced staging ring, 4 MB per frame at most
+    StagingUploader staging;
+    if (!staging.Create(16 * 1024 * 1024, 4 * 1024 * 1024))
+        return -1;
+    GpuHeap::Handle streamTarget = GpuHeap::INVALID;
+    std::vector<unsigned char> streamAsset((size_t)streamBytes, 0x5a);
+    if (streamBytes > 0 && (streamTarget = meshHeap.Allocate(streamBytes)) == GpuHeap::INVALID)
+        std::cout << "Stream asset does not fit the mesh heap, streaming disabled" << std::endl;
+
+    for (int i = 0; i < windowCount; ++i)
+    {
+        GLFWwindow* window = windows.OpenWindow(800, 600, "LearnOpenGL", visible);
+        if (!SetActiveWindow(window))
+            return -1;
+        ConfigureContext(window, contextMode);
+
+        display.Track(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetWindowContentScaleCallback(window, content_scale_callback);
+    }
+
+    if (streamAssetsMegabytes > 0)
+        RunAssetStreamingBenchmark(windows.Window(0), uploads, streamAssetsMegabytes);
+
+    // vertex arrays are not shared between contexts, the queue benchmark draws in the first window only
+    RenderQueue queue;
+    std::vector<VertexArray> benchVertexArrays;
+    double queueSortSeconds = 0.0;
+    double queueExecuteSeconds = 0.0;
+    if (queueBenchCount > 0)
+    {
+        SetActiveWindow(windows.Window(0));
+        benchVertexArrays.resize(64);
+        for (VertexArray& vertexArray : benchVertexArrays)
+            vertexArray.Create();
+        for (int i = 0; i < 32; ++i)
+        {
+            Material material;
+            material.blend = (i & 1) != 0;
+            material.depthWrite = (i & 2) == 0;
+            material.cullBackFaces = (i & 4) == 0;
+            queue.AddMaterial(material);
+        }
+    }
+
+    // GPU-driven scene; its buffers are shared, the vertex array belongs to the first window
+    GpuScene gpuScene;
+    VertexArray gpuSceneVertexArray;
+    ComputeScheduler computeScheduler;
+    AsyncProgramHandle gpuSceneProgram;
+    AsyncProgramHandle gpuCullProgram;
+    double gpuSceneSubmitSeconds = 0.0;
+    unsigned long long gpuSceneFrames = 0;
+    if (gpuSceneCount > 0)
+    {
+        SetActiveWindow(windows.Window(0));
+        if (!gpuScene.Create(1024, 4096, 16, gpuSceneCount))
+            return -1;
+        BuildGpuSceneBenchmark(gpuScene, gpuSceneCount);
+        gpuSceneVertexArray.Create();
+        gpuScene.SetupVertexArray(gpuSceneVertexArray);
+        gpuSceneProgram = shaderReload.Load(shaderBuilder, { "gpu_scene", "gpu_scene.vert", "basic.frag", "", {} }, fallbackProgram);
+        gpuCullProgram = shaderReload.Load(shaderBuilder, { "gpu_cull", "", "", "gpu_cull.comp", {} });
+    }
+
+    // forest: two meshes in shared buffers, one vertex array in the first window
+    Buffer forestVertices;
+    Buffer forestIndices;
+    VertexArray forestVertexArray;
+    AsyncProgramHandle instancedProgram;
+    unsigned long long forestDraws = 0;
+    if (forestCount > 0)
+    {
+        SetActiveWindow(windows.Window(0));
+        CreateForestMeshes(forestVertices, forestIndices, forestVertexArray, frameData);
+        instancedProgram = shaderReload.Load(shaderBuilder, { "instanced", "instanced.vert", "basic.frag", "", {} }, fallbackProgram);
+        if (queueBenchCount == 0)
+        {
+            queue.AddMaterial(Material()); // bark
+            queue.AddMaterial(Material()); // leaves
+        }
+    }
+
+    // uber shader permutations, compiled on first use; last run's variants are pre-warmed
+    std::unique_ptr<ShaderPermutations> permutations;
+    PermutationScene permutationScene;
+    unsigned long long permutationStalls = 0;
+    double permutationStallMs = 0.0;
+    // the plain uber program is tracked for edits only; a successful rebuild reloads the variants
+    AsyncProgramHandle uberProgram;
+    unsigned int permutationReloads = 0;
+    if (permutationDemo)
+    {
+        SetActiveWindow(windows.Window(0));
+        CreatePermutationScene(permutationScene);
+        permutations = std::make_unique<ShaderPermutations>(
+            LoadProgramSource("uber", "shaders/uber.vert", "shaders/uber.frag"), &shaderCache, "shader_cache");
+        permutations->SetFallback(fallbackProgram);
+        permutations->PreWarm(shaderBuilder);
+        uberProgram = shaderReload.Load(shaderBuilder, { "uber", "uber.vert", "uber.frag", "", {} }, fallbackProgram);
+        permutationReloads = shaderReload.Reloads();
+    }
 
-    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGTH);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    
+    // material matrix; the stage programs are shared, the pipelines belong to the first window
+    MaterialMatrix materialMatrix;
+    if (materialMatrixDemo)
+    {
+        SetActiveWindow(windows.Window(0));
+        if (CreateMaterialMatrix(materialMatrix, separableMatrix))
+            ReportMaterialMatrix(materialMatrix);
+        else
+            materialMatrixDemo = false;
+    }
 
-    while (!glfwWindowShouldClose(window))
+    unsigned long long frames = 0;
+    double startTime = glfwGetTime();
+    // with --count-gl-calls, every state call the loop makes outside the cache shows up as a
+    // difference between the calls the cache let through and the calls the driver saw
+    unsigned long long issuedAtStart = GLStateCache::TotalRequests() - GLStateCache::TotalFiltered();
+    unsigned long long driverCallsAtStart = DriverCalls();
+    // filtered share of each frame's state calls, the first frame's counters also hold the setup
+    double filteredPercentMin = 100.0;
+    double filteredPercentMax = 0.0;
+    double filteredPercentSum = 0.0;
+    unsigned long long filteredPercentFrames = 0;
+    while (!windows.ShouldClose())
     {
-        glfwSwapBuffers(window);
+        // input
+        // -----
+        for (size_t i = 0; i < windows.WindowCount(); ++i)
+            processInput(windows.Window(i));
+
+        DebugOutput::BeginFrame();
+        GLStateCache::BeginFrame();
+        if (frames > 0 && GLStateCache::RequestsLastFrame() > 0)
+        {
+            double percent = GLStateCache::FilteredPercentLastFrame();
+            filteredPercentMin = std::min(filteredPercentMin, percent);
+            filteredPercentMax = std::max(filteredPercentMax, percent);
+            filteredPercentSum += percent;
+            filteredPercentFrames++;
+        }
+        computeScheduler.BeginFrame();
+        frameData.BeginFrame();
+
+        shaderBuilder.Poll();
+        shaderReload.Update(shaderBuilder);
+        if (permutations)
+        {
+            if (shaderReload.Reloads() != permutationReloads)
+            {
+                permutationReloads = shaderReload.Reloads();
+                permutations->Reload(LoadProgramSource("uber", "shaders/uber.vert", "shaders/uber.frag"));
+            }
+            permutations->BeginFrame();
+            if (permutations->StallsLastFrame() > 0)
+            {
+                std::cout << "Frame " << frames - 1 << ": " << permutations->StallsLastFrame() << " permutation compile stall(s), "
+                    << permutations->StallMillisecondsLastFrame() << " ms" << std::endl;
+                permutationStalls += permutations->StallsLastFrame();
+                permutationStallMs += permutations->StallMillisecondsLastFrame();
+            }
+        }
+        if (!shadersReported && shaderBuilder.Pending() == 0)
+        {
+            std::cout << "Shaders ready in " << (glfwGetTime() - shaderStart) * 1000.0 << " ms ("
+                << shaderCache.Hits() << " cached, " << shaderCache.Misses() << " compiled"
+                << ", " << shaderReload.UniquePrograms() << " distinct of " << shaderReload.BuildRequests() << " requested"
+                << (useSpirv ? ", basic from SPIR-V; --spirv-bench compares the two paths" : "") << ")" << std::endl;
+            shadersReported = true;
+        }
+
+        queue.Clear();
+        if (queueBenchCount > 0 && basicProgram->Current() != 0)
+            RecordQueueBenchmark(queue, queueBenchCount, basicProgram->Current(), benchVertexArrays);
+        if (forestCount > 0 && instancedProgram->Current() != 0)
+            RecordForestBenchmark(queue, forestCount, instancedProgram->Current(), forestVertexArray);
+        if (queue.Size() > 0)
+        {
+            double sortStart = glfwGetTime();
+            queue.Sort();
+            if (forestCount > 0)
+                queue.Batch(frameData, instancing);
+            queueSortSeconds += glfwGetTime() - sortStart;
+        }
+
+        windows.SubmitAll([&](GLFWwindow* window) {
+            display.BeginScene(window);
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (window == windows.Window(0) && queue.Size() > 0)
+            {
+                double executeStart = glfwGetTime();
+                if (forestCount > 0)
+                {
+                    float viewProjection[16];
+                    PerspectiveMatrix(WindowAspect(window), 0.1f, 1000.0f, viewProjection);
+                    glProgramUniformMatrix4fv(instancedProgram->Current(), 0, 1, GL_FALSE, viewProjection);
+                }
+                queue.Execute(GLState());
+                // the batched instance data lives in this frame's ring region
+                if (forestCount > 0)
+                    frameData.FenceConsumer();
+                queueExecuteSeconds += glfwGetTime() - executeStart;
+                forestDraws += queue.DrawsLastExecute();
+            }
+            if (window == windows.Window(0) && gpuSceneCount > 0 && gpuSceneProgram->Current() != 0)
+            {
+                double submitStart = glfwGetTime();
+                // camera at the origin looking down -z, far plane at 1000; the frustum follows the window's shape
+                float projection[16];
+                PerspectiveMatrix(WindowAspect(window), 0.1f, 1000.0f, projection);
+                gpuScene.SetCamera(projection);
+                // the CPU-culled path also covers the frames before the cull shader is ready
+                if (perObjectDraws || gpuCullProgram->Current() == 0)
+                    gpuScene.DrawPerObject(GLState(), gpuSceneProgram->Current(), gpuSceneVertexArray);
+                else
+                {
+                    gpuScene.Cull(computeScheduler, gpuCullProgram->Current());
+                    gpuScene.Draw(computeScheduler, GLState(), gpuSceneProgram->Current(), gpuSceneVertexArray);
+                }
+                gpuSceneSubmitSeconds += glfwGetTime() - submitStart;
+                gpuSceneFrames++;
+            }
+            if (window == windows.Window(0) && permutations)
+                DrawPermutationScene(permutationScene, *permutations, WindowAspect(window));
+            if (window == windows.Window(0) && materialMatrixDemo)
+                DrawMaterialMatrix(materialMatrix, GLState());
+            display.EndScene(window);
+        });
+        if (streamTarget != GpuHeap::INVALID && staging.PendingBytes() == 0)
+            staging.WriteBuffer(meshHeap, streamTarget, 0, streamAsset.data(), streamBytes);
+        staging.Flush();
+        windows.Flush();
+        meshHeap.Defragment(256 * 1024);
+        frameData.EndFrame();
         glfwPollEvents();
+        frames++;
+
+        bool framesDone = frameLimit > 0 && frames >= (unsigned long long)frameLimit;
+        bool secondsDone = secondsLimit > 0.0 && glfwGetTime() - startTime >= secondsLimit;
+        if (framesDone || secondsDone)
+        {
+            for (size_t i = 0; i < windows.WindowCount(); ++i)
+                glfwSetWindowShouldClose(windows.Window(i), true);
+        }
+    }
+
+    if (frames > 0)
+    {
+        double frameTime = (glfwGetTime() - startTime) * 1000.0 / frames;
+        std::cout << windowCount << " window(s): " << frameTime << " ms/frame over " << frames << " frames" << std::endl;
+        if (forestCount > 0)
+        {
+            std::cout << "Forest: " << forestCount << " trees, " << (instancing ? "instanced" : "not instanced") << ", "
+                << (double)forestDraws / frames << " draws/frame, sort+batch " << queueSortSeconds * 1000.0 / frames
+                << " ms, execute " << queueExecuteSeconds * 1000.0 / frames << " ms, over " << frames << " frames" << std::endl;
+        }
+        else if (queueBenchCount > 0)
+        {
+            std::cout << "Render queue: " << queueBenchCount << " draws/frame, sort " << queueSortSeconds * 1000.0 / frames
+                << " ms, execute " << queueExecuteSeconds * 1000.0 / frames << " ms, "
+                << queue.MaterialChangesLastExecute() << " material changes, over " << frames << " frames" << std::endl;
+        }
+        if (gpuSceneFrames > 0)
+        {
+            std::cout << "GPU scene: " << gpuSceneCount << " objects, ";
+            if (perObjectDraws)
+                std::cout << gpuScene.VisibleLastDraw() << " per-object draws";
+            else
+                std::cout << (gpuScene.IndirectCountSupported() ? "multi-draw indirect count" : "multi-draw indirect");
+            std::cout << ", " << gpuSceneSubmitSeconds * 1000.0 / gpuSceneFrames << " ms CPU submission/frame over "
+                << gpuSceneFrames << " frames" << std::endl;
+        }
+        if (permutations)
+        {
+            std::cout << "Permutations: " << permutations->Resident() << " variants resident, " << permutationStalls
+                << " compile stall(s) totalling " << permutationStallMs << " ms over " << frames << " frames" << std::endl;
+        }
+        unsigned long long stateCalls = GLStateCache::TotalRequests();
+        if (stateCalls > 0)
+        {
+            std::cout << "State cache filtered " << 100.0 * GLStateCache::TotalFiltered() / stateCalls << "% of "
+                << stateCalls << " state calls";
+            if (countCalls)
+                std::cout << ", " << (double)DriverCalls() / frames << " reached the driver per frame";
+            std::cout << std::endl;
+        }
+        if (filteredPercentFrames > 0)
+        {
+            std::cout << "State cache filtered per frame: min " << filteredPercentMin << "%, avg "
+                << filteredPercentSum / filteredPercentFrames << "%, max " << filteredPercentMax << "% over "
+                << filteredPercentFrames << " frames" << std::endl;
+        }
+        if (countCalls)
+        {
+            unsigned long long issued = GLStateCache::TotalRequests() - GLStateCache::TotalFiltered() - issuedAtStart;
+            unsigned long long reached = DriverCalls() - driverCallsAtStart;
+            if (issued != reached)
+                std::cout << "ERROR::GL_STATE_CACHE::BYPASSED " << (long long)(reached - issued)
+                    << " state calls reached the driver without going through the cache" << std::endl;
+            else
+                std::cout << "State cache accounts for all " << reached << " state calls that reached the driver" << std::endl;
+        }
+        if (streamBytes > 0)
+        {
+            double seconds = glfwGetTime() - startTime;
+            std::cout << "Streamed " << staging.BytesUploaded() / (1024.0 * 1024.0) << " MB at "
+                << staging.BytesUploaded() / (1024.0 * 1024.0) / seconds << " MB/s, staging "
+                << staging.FlushSeconds() * 1000.0 / frames << " ms/frame, starved " << staging.Starved() << " of " << frames
+                << " frame(s)" << std::endl;
+        }
     }
 
+    if (!benchVertexArrays.empty() || gpuSceneCount > 0 || forestCount > 0 || permutationDemo || materialMatrixDemo)
+    {
+        SetActiveWindow(windows.Window(0));
+        ReleaseMaterialMatrix(materialMatrix);
+        benchVertexArrays.clear();
+        gpuSceneVertexArray.Release();
+        forestVertexArray.Release();
+        permutationScene.vertexArray.Release();
+    }
+    // scene targets are framebuffers, which belong to their window's context
+    for (size_t i = 0; i < windows.WindowCount(); ++i)
+    {
+        SetActiveWindow(windows.Window(i));
+        display.Untrack(windows.Window(i));
+    }
+    shaderReload.Stop();
+    uploads.Stop();
+    SetActiveWindow(resourceContext);
+    glDeleteProgram(fallbackProgram);
+    permutations.reset();
+    permutationScene = PermutationScene();
+    frameData.Destroy();
+    staging.Destroy();
+    meshHeap.Destroy();
+    gpuScene.Destroy();
+    forestVertices.Release();
+    forestIndices.Release();
+    windows.Destroy();
+    DebugOutput::Shutdown();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -70,21 +755,1709 @@ void processInput(GLFWwindow* window)
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    // make sure the viewport matches the new window dimensions; note that width and 
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    // the viewport follows the new window dimensions through the render scale policy; note that
+    // width and height will be significantly larger than specified on retina displays.
+    display.OnFramebufferSize(window, width, height);
 }
 
-bool SetActiveWindow(GLFWwindow* window)
+// glfw: whenever the window moves to a monitor with a different content scale this callback function executes
+// -----------------------------------------------------------------------------------------------------------
+void content_scale_callback(GLFWwindow* window, float xscale, float yscale)
 {
-    bool success = true;
-    if (window == NULL)
+    display.OnContentScale(window, xscale, yscale);
+}
+
+// --state-cache-selftest: the glad entry points the cache calls are pointed at stubs that only
+// count, so no context is needed. Each step states how many calls must reach the "driver"
+// ------------------------------------------------------------------------------------------------
+namespace
+{
+    unsigned long long stubCalls = 0;
+
+    void APIENTRY StubUseProgram(GLuint) { stubCalls++; }
+    void APIENTRY StubBindBuffer(GLenum, GLuint) { stubCalls++; }
+    void APIENTRY StubBindBufferBase(GLenum, GLuint, GLuint) { stubCalls++; }
+    void APIENTRY StubActiveTexture(GLenum) { stubCalls++; }
+    void APIENTRY StubBindTexture(GLenum, GLuint) { stubCalls++; }
+    void APIENTRY StubViewport(GLint, GLint, GLsizei, GLsizei) { stubCalls++; }
+    void APIENTRY StubEnable(GLenum) { stubCalls++; }
+}
+
+bool RunStateCacheSelfTest()
+{
+    PFNGLUSEPROGRAMPROC useProgram = glad_glUseProgram;
+    PFNGLBINDBUFFERPROC bindBuffer = glad_glBindBuffer;
+    PFNGLBINDBUFFERBASEPROC bindBufferBase = glad_glBindBufferBase;
+    PFNGLACTIVETEXTUREPROC activeTexture = glad_glActiveTexture;
+    PFNGLBINDTEXTUREPROC bindTexture = glad_glBindTexture;
+    PFNGLVIEWPORTPROC viewport = glad_glViewport;
+    PFNGLENABLEPROC enable = glad_glEnable;
+    glad_glUseProgram = StubUseProgram;
+    glad_glBindBuffer = StubBindBuffer;
+    glad_glBindBufferBase = StubBindBufferBase;
+    glad_glActiveTexture = StubActiveTexture;
+    glad_glBindTexture = StubBindTexture;
+    glad_glViewport = StubViewport;
+    glad_glEnable = StubEnable;
+
+    // two contexts by name only; the caches never dereference them
+    int contextStorage[2];
+    GLFWwindow* first = (GLFWwindow*)&contextStorage[0];
+    GLFWwindow* second = (GLFWwindow*)&contextStorage[1];
+    unsigned long long issuedBefore = GLStateCache::TotalRequests() - GLStateCache::TotalFiltered();
+    stubCalls = 0;
+    int failures = 0;
+    int checks = 0;
+    auto expect = [&](const char* step, unsigned long long calls) {
+        unsigned long long issued = GLStateCache::TotalRequests() - GLStateCache::TotalFiltered() - issuedBefore;
+        checks++;
+        if (stubCalls != calls || issued != calls)
+        {
+            std::cout << "ERROR::STATE_CACHE_SELFTEST " << step << ": expected " << calls << " driver calls, got "
+                << stubCalls << " (cache issued " << issued << ")" << std::endl;
+            failures++;
+        }
+        stubCalls = 0;
+        issuedBefore += issued;
+    };
+
+    SelectStateCache(first);
+    GLState().UseProgram(1);
+    GLState().UseProgram(1);
+    GLState().UseProgram(2);
+    expect("program", 2);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    GLState().BindBufferBase(GL_UNIFORM_BUFFER, 0, 5);
+    GLState().BindBufferBase(GL_UNIFORM_BUFFER, 0, 5);
+    GLState().BindBuffer(GL_UNIFORM_BUFFER, 5); // the indexed bind set the generic binding too
+    expect("buffers", 2);
+    GLState().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
+    GLState().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
+    expect("element buffer pass-through", 2);
+    GLState().BindTexture(2, GL_TEXTURE_2D, 7);
+    GLState().BindTexture(2, GL_TEXTURE_2D, 7);
+    GLState().BindTexture(2, GL_TEXTURE_2D, 8);
+    expect("textures", 3); // the unit switch once, then two binds
+    GLState().Viewport(0, 0, 800, 600);
+    GLState().Viewport(0, 0, 800, 600);
+    GLState().SetEnabled(GL_DEPTH_TEST, true);
+    GLState().SetEnabled(GL_DEPTH_TEST, true);
+    expect("viewport and capabilities", 2);
+    GLState().Invalidate();
+    GLState().UseProgram(2);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    expect("after Invalidate", 2);
+
+    SelectStateCache(second);
+    GLState().UseProgram(2);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    expect("second context starts unknown", 2);
+    SelectStateCache(first);
+    GLState().UseProgram(2);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    expect("first context kept its state", 0);
+
+    // buffer 5 deleted in the first context; the second still has the old object bound
+    GLState().ForgetBuffer(5);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 0);
+    expect("deleting context knows the name is unbound", 0);
+    SelectStateCache(second);
+    GLState().BindBuffer(GL_ARRAY_BUFFER, 5);
+    expect("other context rebinds a reused name", 1);
+
+    SelectStateCache(nullptr);
+    ReleaseStateCache(first);
+    ReleaseStateCache(second);
+    glad_glUseProgram = useProgram;
+    glad_glBindBuffer = bindBuffer;
+    glad_glBindBufferBase = bindBufferBase;
+    glad_glActiveTexture = activeTexture;
+    glad_glBindTexture = bindTexture;
+    glad_glViewport = viewport;
+    glad_glEnable = enable;
+
+    if (failures == 0)
+        std::cout << "State cache self-test: all " << checks << " checks passed" << std::endl;
+    return failures == 0;
+}
+
+// --debug-selftest: errors every driver reports (Mesa included) plus application-inserted
+// performance messages; the aggregator must count every repeat and keep one entry per message
+// ------------------------------------------------------------------------------------------------
+void RunDebugOutputSelfTest(int repeats)
+{
+    auto countErrors = []() {
+        uint64_t count = 0;
+        for (const DebugOutput::MessageStats& message : DebugOutput::Snapshot())
+        {
+            if (message.type == GL_DEBUG_TYPE_ERROR && message.source == GL_DEBUG_SOURCE_API)
+                count += message.count;
+        }
+        return count;
+    };
+    if (!DebugOutput::Drain(1000))
+    {
+        std::cout << "Debug output self-test: debug output is not running" << std::endl;
+        return;
+    }
+    uint64_t errorsBefore = countErrors();
+    size_t messagesBefore = DebugOutput::Snapshot().size();
+    uint64_t droppedBefore = DebugOutput::DroppedMessages();
+    DebugOutput::BeginFrame();
+
+    const char* warning = "self-test performance warning";
+    for (int i = 0; i < repeats; ++i)
+    {
+        glEnable(0xDEAD);      // GL_INVALID_ENUM
+        glUseProgram(0xFFFFF); // GL_INVALID_VALUE, never a program name
+        glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PERFORMANCE, 1,
+            GL_DEBUG_SEVERITY_LOW, -1, warning);
+    }
+    while (glGetError() != GL_NO_ERROR)
+        ;
+    bool drained = DebugOutput::Drain(1000);
+    DebugOutput::BeginFrame();
+
+    uint64_t dropped = DebugOutput::DroppedMessages() - droppedBefore;
+    uint64_t errors = countErrors() - errorsBefore;
+    size_t newMessages = DebugOutput::Snapshot().size() - messagesBefore;
+    unsigned int performance = DebugOutput::PerformanceMessagesLastFrame();
+    // three distinct messages, unless the driver gives every occurrence an id of its own
+    bool pass = drained && errors + dropped == 2ull * repeats && performance + dropped >= (unsigned int)repeats
+        && newMessages <= 3;
+    std::cout << "Debug output self-test: " << errors << "/" << 2 * repeats << " errors, " << performance << "/"
+        << repeats << " performance messages, " << newMessages << " new distinct message(s), " << dropped
+        << " dropped: " << (pass ? "PASS" : "FAIL") << std::endl;
+}
+
+// --submit-bench: the same draw loop in a throwaway context of each mode. Every draw switches
+// vertex array, sets a uniform and draws a point, all straight to the driver, so the CPU time is
+// the driver's per-call cost including (or not) its error checking
+// ------------------------------------------------------------------------------------------------
+void RunSubmissionBenchmark(int draws, ContextMode restoreMode)
+{
+    const char* vertexSource =
+        "#version 460 core\n"
+        "layout(location = 0) uniform vec4 offset;\n"
+        "void main() { gl_Position = offset; }\n";
+    const char* fragmentSource =
+        "#version 460 core\n"
+        "layout(location = 0) out vec4 FragColor;\n"
+        "void main() { FragColor = vec4(1.0); }\n";
+
+    const ContextMode modes[2] = { ContextMode::NoError, ContextMode::Validating };
+    double seconds[2] = { 0.0, 0.0 };
+    for (int m = 0; m < 2; ++m)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        success = false;
+        ApplyContextHints(modes[m]);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        GLFWwindow* context = glfwCreateWindow(1, 1, "submit-bench", NULL, NULL);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (context == NULL)
+        {
+            std::cout << "ERROR::SUBMIT_BENCH::CONTEXT_CREATION_FAILED" << std::endl;
+            continue;
+        }
+        SetActiveWindow(context);
+        ContextMode granted = ConfigureContext(context, modes[m]);
+
+        GLuint shaders[2] = {
+            CompileShader(GL_VERTEX_SHADER, vertexSource, "submit-bench"),
+            CompileShader(GL_FRAGMENT_SHADER, fragmentSource, "submit-bench"),
+        };
+        GLuint program = LinkProgram({ shaders[0], shaders[1] }, "submit-bench", false);
+        glDeleteShader(shaders[0]);
+        glDeleteShader(shaders[1]);
+        GLuint vertexArrays[2];
+        glGenVertexArrays(2, vertexArrays);
+        glUseProgram(program);
+
+        // best of five, after a warm-up pass
+        double best = 1e9;
+        for (int run = 0; run < 6; ++run)
+        {
+            glFinish();
+            double start = glfwGetTime();
+            for (int i = 0; i < draws; ++i)
+            {
+                glBindVertexArray(vertexArrays[i & 1]);
+                glUniform4f(0, (float)(i & 15) / 16.0f, 0.0f, 0.0f, 1.0f);
+                glDrawArrays(GL_POINTS, 0, 1);
+            }
+            double elapsed = glfwGetTime() - start;
+            if (run > 0)
+                best = std::min(best, elapsed);
+        }
+        glFinish();
+        seconds[m] = best;
+        std::cout << "Submission (" << ContextModeName(granted) << " context): " << draws << " draws in "
+            << best * 1000.0 << " ms, " << best * 1e9 / draws << " ns/draw" << std::endl;
+
+        glDeleteVertexArrays(2, vertexArrays);
+        glDeleteProgram(program);
+        DebugOutput::Uninstall();
+        glfwMakeContextCurrent(NULL);
+        SelectStateCache(NULL);
+        ReleaseStateCache(context);
+        glfwDestroyWindow(context);
     }
-    glfwMakeContextCurrent(window);
-    return success;
+    if (seconds[0] > 0.0 && seconds[1] > 0.0)
+        std::cout << "Submission: no-error is " << seconds[1] / seconds[0] << "x the speed of validating" << std::endl;
+    ApplyContextHints(restoreMode);
 }
 
+// --stream-assets: 4 MB assets, alternately a 1024x1024 RGBA8 texture and a buffer, one new asset
+// per frame. The asset bytes are copied out of a template on the render thread in both modes (the
+// stand-in for reading the file); only where the GL upload runs differs. A frame is a clear plus
+// glFinish, so its time is what the upload adds to an otherwise idle frame
+// ------------------------------------------------------------------------------------------------
+void RunAssetStreamingBenchmark(GLFWwindow* window, UploadContext& uploads, int megabytes)
+{
+    const int side = 1024;
+    const size_t assetBytes = (size_t)side * side * 4;
+    const int assetCount = std::max(1, (int)((size_t)megabytes * 1024 * 1024 / assetBytes));
+    const size_t maxInFlight = 8; // bounds the copies waiting on the loader thread
+    std::vector<unsigned char> asset(assetBytes);
+    for (size_t i = 0; i < assetBytes; ++i)
+        asset[i] = (unsigned char)(i * 31);
+
+    SetActiveWindow(window);
+    const char* names[2] = { "render thread", "loader thread" };
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        struct InFlight
+        {
+            UploadHandle upload;
+            bool texture;
+        };
+        std::vector<InFlight> inFlight;
+        std::vector<double> frameTimes;
+        int issued = 0;
+        int completed = 0;
+        double start = glfwGetTime();
+        while (completed < assetCount)
+        {
+            double frameStart = glfwGetTime();
+            bool texture = (issued & 1) == 0;
+            if (mode == 0)
+            {
+                std::vector<unsigned char> data(asset);
+                if (texture)
+                {
+                    Texture object;
+                    object.Create2D(GL_RGBA8, side, side);
+                    object.SetImage(0, 0, 0, side, side, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+                }
+                else
+                {
+                    Buffer object;
+                    object.Create((GLsizeiptr)data.size(), data.data(), 0);
+                }
+                issued++;
+                completed++;
+            }
+            else
+            {
+                if (issued < assetCount && inFlight.size() < maxInFlight)
+                {
+                    std::vector<unsigned char> data(asset);
+                    UploadHandle upload = texture ? uploads.UploadTexture(side, side, std::move(data))
+                        : uploads.UploadBuffer(std::move(data));
+                    inFlight.push_back({ upload, texture });
+                    issued++;
+                }
+                for (size_t i = 0; i < inFlight.size();)
+                {
+                    if (!UploadContext::IsReady(*inFlight[i].upload))
+                    {
+                        ++i;
+                        continue;
+                    }
+                    GLuint object = inFlight[i].upload->object;
+                    if (inFlight[i].texture)
+                    {
+                        GLState().ForgetTexture(object);
+                        glDeleteTextures(1, &object);
+                    }
+                    else
+                    {
+                        GLState().ForgetBuffer(object);
+                        glDeleteBuffers(1, &object);
+                    }
+                    inFlight.erase(inFlight.begin() + i);
+                    completed++;
+                }
+            }
+            glClear(GL_COLOR_BUFFER_BIT);
+            glFinish();
+            glfwPollEvents();
+            frameTimes.push_back((glfwGetTime() - frameStart) * 1000.0);
+        }
+        double seconds = glfwGetTime() - start;
+
+        std::sort(frameTimes.begin(), frameTimes.end());
+        double mean = 0.0;
+        for (double frameTime : frameTimes)
+            mean += frameTime;
+        mean /= frameTimes.size();
+        double p99 = frameTimes[std::min(frameTimes.size() - 1, frameTimes.size() * 99 / 100)];
+        std::cout << "Streaming " << assetCount * assetBytes / (1024 * 1024) << " MB from the " << names[mode] << ": "
+            << frameTimes.size() << " frames, mean " << mean << " ms, p99 " << p99 << " ms, worst " << frameTimes.back()
+            << " ms, " << assetCount * assetBytes / (1024.0 * 1024.0) / seconds << " MB/s" << std::endl;
+    }
+}
+
+// --cache-bench: N variants of the basic program, each with a define of its own so neither this
+// cache nor the driver's own shader cache has seen them. The cold pass compiles, links and stores
+// every binary in a scratch cache directory, the warm pass restores them all from disk
+// ------------------------------------------------------------------------------------------------
+void RunProgramCacheBenchmark(int programs)
+{
+    const std::string directory = "shader_cache/bench";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    ProgramBinaryCache cache(directory);
+    if (!cache.Init())
+        return;
+
+    ProgramSource base = LoadProgramSource("basic", "shaders/basic.vert", "shaders/basic.frag");
+    unsigned long long salt = (unsigned long long)(glfwGetTime() * 1e6) ^ (unsigned long long)std::time(nullptr);
+    std::vector<ProgramSource> sources(programs, base);
+    for (int i = 0; i < programs; ++i)
+        sources[i].defines.push_back("CACHE_BENCH_VARIANT " + std::to_string(salt) + std::to_string(i));
+
+    const char* names[2] = { "cold", "warm" };
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        unsigned int hitsBefore = cache.Hits();
+        std::vector<GLuint> built;
+        double start = glfwGetTime();
+        for (const ProgramSource& source : sources)
+            built.push_back(cache.GetOrBuild(source));
+        glFinish();
+        double ms = (glfwGetTime() - start) * 1000.0;
+        for (GLuint program : built)
+            glDeleteProgram(program);
+        std::cout << "Program cache " << names[pass] << ": " << programs << " programs in " << ms << " ms ("
+            << ms / programs << " ms each), " << cache.Hits() - hitsBefore << " restored from disk" << std::endl;
+    }
+    std::filesystem::remove_all(directory, error);
+}
+
+// --build-bench: N programs cycling through the repo's vertex stages, salted per run and per mode
+// so no driver cache helps. Serial mode finishes one program per Poll, parallel mode issues every
+// compile at Submit and Poll only checks completion; one Poll stands for one frame, so the worst
+// Poll is the worst frame stall
+// ------------------------------------------------------------------------------------------------
+void RunProgramBuildBenchmark(int programs)
+{
+    const char* vertexStages[] = { "basic.vert", "instanced.vert", "packed_mesh.vert", "gpu_scene.vert" };
+    std::vector<ProgramSource> bases;
+    for (const char* stage : vertexStages)
+        bases.push_back(LoadProgramSource(stage, std::string("shaders/") + stage, "shaders/basic.frag"));
+    unsigned long long salt = (unsigned long long)std::time(nullptr);
+
+    AsyncProgramBuilder builder;
+    builder.Init();
+    bool parallelSupported = builder.Parallel();
+    for (int mode = 0; mode < (parallelSupported ? 2 : 1); ++mode)
+    {
+        builder.SetParallel(mode == 1);
+        std::vector<AsyncProgramHandle> handles;
+        double start = glfwGetTime();
+        for (int i = 0; i < programs; ++i)
+        {
+            ProgramSource source = bases[i % bases.size()];
+            source.defines.push_back("BUILD_BENCH_VARIANT " + std::to_string(salt) + std::to_string(mode * programs + i));
+            handles.push_back(builder.Submit(source));
+        }
+        double submitMs = (glfwGetTime() - start) * 1000.0;
+
+        double worstPoll = 0.0;
+        unsigned int polls = 0;
+        while (builder.Pending() > 0)
+        {
+            double pollStart = glfwGetTime();
+            builder.Poll();
+            worstPoll = std::max(worstPoll, glfwGetTime() - pollStart);
+            polls++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // the rest of a frame
+        }
+        double totalMs = (glfwGetTime() - start) * 1000.0;
+
+        unsigned int failed = 0;
+        for (const AsyncProgramHandle& handle : handles)
+        {
+            failed += handle->failed ? 1 : 0;
+            glDeleteProgram(handle->program);
+        }
+        std::cout << "Building " << programs << " programs " << (mode == 1 ? "in parallel" : "serially") << ": "
+            << totalMs << " ms total, " << submitMs << " ms submitting, worst frame stall " << worstPoll * 1000.0
+            << " ms over " << polls << " polls, " << failed << " failed" << std::endl;
+    }
+    if (!parallelSupported)
+        std::cout << "Building in parallel needs KHR_parallel_shader_compile" << std::endl;
+}
+
+// --spirv-bench: every program main uses, built from GLSL (glShaderSource + glCompileShader) and
+// from the modules of tools/compile_shaders.sh (glShaderBinary + glSpecializeShader), compile and
+// link timed apart. Drivers with a shader cache (Mesa) skip repeated work in both paths; run with
+// MESA_SHADER_CACHE_DISABLE=true to time the full front end every time
+// ------------------------------------------------------------------------------------------------
+void RunSpirvBenchmark(int repeats)
+{
+    if (!SpirvSupported())
+    {
+        std::cout << "SPIR-V shaders not supported by the driver" << std::endl;
+        return;
+    }
+    const std::vector<std::vector<std::pair<GLenum, std::string>>> programs = {
+        { { GL_VERTEX_SHADER, "basic.vert" }, { GL_FRAGMENT_SHADER, "basic.frag" } },
+        { { GL_VERTEX_SHADER, "instanced.vert" }, { GL_FRAGMENT_SHADER, "basic.frag" } },
+        { { GL_VERTEX_SHADER, "gpu_scene.vert" }, { GL_FRAGMENT_SHADER, "basic.frag" } },
+        { { GL_VERTEX_SHADER, "packed_mesh.vert" }, { GL_FRAGMENT_SHADER, "basic.frag" } },
+        { { GL_COMPUTE_SHADER, "gpu_cull.comp" } },
+    };
+
+    double seconds[2][2] = {}; // [GLSL, SPIR-V][compile, link]
+    int built = 0;
+    for (const auto& stages : programs)
+    {
+        bool available = true;
+        for (const auto& stage : stages)
+            available = available && std::filesystem::exists(SpirvModulePath(stage.second + ".spv"));
+        if (!available)
+        {
+            std::cout << "No SPIR-V module for " << stages[0].second << ", run tools/compile_shaders.sh" << std::endl;
+            continue;
+        }
+
+        for (int repeat = 0; repeat < repeats; ++repeat)
+        {
+            for (int path = 0; path < 2; ++path)
+            {
+                std::vector<GLuint> shaders;
+                double start = glfwGetTime();
+                for (const auto& stage : stages)
+                {
+                    if (path == 0)
+                        shaders.push_back(CompileShader(stage.first, ReadShaderFile("shaders/" + stage.second), stage.second));
+                    else
+                        shaders.push_back(LoadSpirvShader({ stage.first, SpirvModulePath(stage.second + ".spv"), "main", {} }));
+                }
+                double compiled = glfwGetTime();
+                GLuint program = LinkProgram(shaders, stages[0].second, false);
+                glFinish();
+                double linked = glfwGetTime();
+                seconds[path][0] += compiled - start;
+                seconds[path][1] += linked - compiled;
+                for (GLuint shader : shaders)
+                    glDeleteShader(shader);
+                glDeleteProgram(program);
+            }
+        }
+        built++;
+    }
+    if (built == 0)
+        return;
+
+    const char* names[2] = { "GLSL", "SPIR-V" };
+    int builds = built * repeats;
+    for (int path = 0; path < 2; ++path)
+    {
+        std::cout << names[path] << ": " << builds << " program builds, compile " << seconds[path][0] * 1000.0 / builds
+            << " ms, link " << seconds[path][1] * 1000.0 / builds << " ms per program" << std::endl;
+    }
+    double glsl = seconds[0][0] + seconds[0][1];
+    double spirv = seconds[1][0] + seconds[1][1];
+    if (spirv > 0.0)
+        std::cout << "SPIR-V builds take " << spirv / glsl * 100.0 << "% of the GLSL time" << std::endl;
+}
+
+// --ring-bench: N frames of 4 MB of dynamic data written in 64 KB pieces, each piece read by the
+// GPU (a buffer copy) right after it is written. Compares the persistently mapped ring with
+// glBufferSubData into one buffer and with orphaning it (glBufferData NULL) before every write
+// ------------------------------------------------------------------------------------------------
+void RunDynamicBufferBenchmark(int frames)
+{
+    const GLsizeiptr frameBytes = 4 * 1024 * 1024;
+    const GLsizeiptr pieceBytes = 64 * 1024;
+    const int pieces = (int)(frameBytes / pieceBytes);
+    std::vector<unsigned char> data((size_t)pieceBytes, 0x3c);
+
+    DynamicBufferRing ring;
+    Buffer consumer;
+    if (!ring.Create(frameBytes) || !consumer.Create(pieceBytes, nullptr, 0))
+        return;
+    GLuint plain;
+    glGenBuffers(1, &plain);
+    GLState().BindBuffer(GL_COPY_READ_BUFFER, plain);
+    glBufferData(GL_COPY_READ_BUFFER, pieceBytes, nullptr, GL_STREAM_DRAW);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, consumer.Name());
+
+    const char* modes[3] = { "ring", "glBufferSubData", "orphaning" };
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            if (mode == 0)
+                ring.BeginFrame();
+            for (int piece = 0; piece < pieces; ++piece)
+            {
+                GLintptr offset = 0;
+                if (mode == 0)
+                {
+                    DynamicBufferRing::Allocation allocation = ring.Allocate(pieceBytes);
+                    memcpy(allocation.cpu, data.data(), (size_t)pieceBytes);
+                    GLState().BindBuffer(GL_COPY_READ_BUFFER, allocation.buffer);
+                    offset = allocation.offset;
+                }
+                else
+                {
+                    GLState().BindBuffer(GL_COPY_READ_BUFFER, plain);
+                    if (mode == 2)
+                        glBufferData(GL_COPY_READ_BUFFER, pieceBytes, nullptr, GL_STREAM_DRAW);
+                    glBufferSubData(GL_COPY_READ_BUFFER, 0, pieceBytes, data.data());
+                }
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, pieceBytes);
+            }
+            if (mode == 0)
+                ring.EndFrame();
+        }
+        glFinish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double megabytes = (double)frameBytes * frames / (1024.0 * 1024.0);
+        std::cout << "Dynamic data " << modes[mode] << ": " << megabytes << " MB in " << seconds * 1000.0 << " ms, "
+            << megabytes / seconds << " MB/s";
+        if (mode == 0)
+            std::cout << ", " << ring.Stalls() << " stall(s)";
+        std::cout << std::endl;
+    }
+    GLState().BindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &plain);
+    GLState().ForgetBuffer(plain);
+}
+
+// --heap-bench: N operations of allocation churn in a 64 MB heap, block sizes spread evenly
+// over 256 B..256 KB on a log scale, the live set kept between half and three quarters full.
+// Runs once without and once with Defragment (256 KB every 100 operations) from the same seed
+// ------------------------------------------------------------------------------------------------
+void RunHeapChurnBenchmark(int operations)
+{
+    const GLsizeiptr capacity = 64 * 1024 * 1024;
+    const uint64_t defragmentBudget = 256 * 1024;
+    const int defragmentInterval = 100;
+    const int reports = 4;
+
+    for (int compact = 0; compact < 2; ++compact)
+    {
+        GpuHeap heap;
+        if (!heap.Create(capacity))
+            return;
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<double> logSize(std::log(256.0), std::log(256.0 * 1024.0));
+        std::vector<GpuHeap::Handle> live;
+        std::vector<double> latencies;
+        latencies.reserve((size_t)operations);
+        uint64_t failed = 0;
+        uint64_t moved = 0;
+
+        std::cout << "Heap churn, " << (compact ? "with" : "without") << " compaction:" << std::endl;
+        for (int operation = 1; operation <= operations; ++operation)
+        {
+            double fill = (double)heap.Used() / capacity;
+            bool allocate = live.empty() || fill < 0.5 || (fill < 0.75 && (random() & 1));
+            if (allocate)
+            {
+                GLsizeiptr size = (GLsizeiptr)std::exp(logSize(random));
+                auto start = std::chrono::steady_clock::now();
+                GpuHeap::Handle handle = heap.Allocate(size);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                if (handle == GpuHeap::INVALID)
+                    failed++;
+                else
+                    live.push_back(handle);
+            }
+            else
+            {
+                size_t victim = random() % live.size();
+                heap.Free(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+
+            if (compact && operation % defragmentInterval == 0)
+                moved += heap.Defragment(defragmentBudget);
+            if (operation % std::max(operations / reports, 1) == 0)
+                std::cout << "  after " << operation << " operations: " << heap.Used() / (1024 * 1024) << " MB live, fragmentation "
+                    << heap.Fragmentation() << std::endl;
+        }
+        glFinish();
+
+        std::sort(latencies.begin(), latencies.end());
+        double p99 = latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+        std::cout << "  " << latencies.size() << " allocations, " << heap.AverageAllocationMicroseconds() << " us average, "
+            << p99 << " us p99, " << failed << " failed";
+        if (compact)
+            std::cout << ", " << moved / (1024 * 1024) << " MB moved";
+        std::cout << std::endl;
+        heap.Destroy();
+    }
+}
+
+// --compute-bench: checks the scheduler's barriers on a small pass chain (read-after-write and
+// write-after-read, results read back), then times N dependent and N independent dispatches
+// with the scheduler's barriers and with a full glMemoryBarrier after every dispatch
+// ------------------------------------------------------------------------------------------------
+void RunComputeBenchmark(int dispatches)
+{
+    if (!GLAD_GL_VERSION_4_3)
+    {
+        std::cout << "ERROR::COMPUTE_BENCH::COMPUTE_NOT_SUPPORTED" << std::endl;
+        return;
+    }
+    const char* source =
+        "#version 460 core\n"
+        "layout(local_size_x = 64) in;\n"
+        "layout(std430, binding = 0) readonly buffer Source { uint source[]; };\n"
+        "layout(std430, binding = 1) writeonly buffer Target { uint target[]; };\n"
+        "layout(location = 0) uniform uint scale;\n"
+        "layout(location = 1) uniform uint count;\n"
+        "void main()\n"
+        "{\n"
+        "    uint i = gl_GlobalInvocationID.x;\n"
+        "    if (i < count)\n"
+        "        target[i] = source[i] * scale + 1u;\n"
+        "}\n";
+    std::vector<GLuint> shaders = { CompileShader(GL_COMPUTE_SHADER, source, "compute-bench") };
+    GLuint program = LinkProgram(shaders, "compute-bench", false);
+    glDeleteShader(shaders[0]);
+    if (program == 0)
+        return;
+
+    const GLuint count = 1 << 20;
+    std::vector<GLuint> ramp(count);
+    for (GLuint i = 0; i < count; ++i)
+        ramp[i] = i;
+    Buffer buffers[4];
+    Buffer targets[8];
+    bool created = true;
+    for (Buffer& buffer : buffers)
+        created = created && buffer.Create(count * sizeof(GLuint), ramp.data(), 0);
+    for (Buffer& buffer : targets)
+        created = created && buffer.Create(count * sizeof(GLuint), nullptr, 0);
+    if (!created)
+    {
+        glDeleteProgram(program);
+        return;
+    }
+    glProgramUniform1ui(program, 1, count);
+
+    ComputeScheduler scheduler;
+    auto pass = [&](const Buffer& from, const Buffer& to, GLuint scale) {
+        ComputePass compute;
+        compute.name = "compute-bench";
+        compute.program = program;
+        compute.resources = {
+            { from.Name(), ResourceUsage::StorageBuffer, ResourceAccess::Read, 0 },
+            { to.Name(), ResourceUsage::StorageBuffer, ResourceAccess::Write, 1 },
+        };
+        compute.groups[0] = (count + 63) / 64;
+        glProgramUniform1ui(program, 0, scale);
+        scheduler.Dispatch(compute);
+    };
+    // the same pass without the scheduler, made safe the blunt way
+    auto fullBarrierPass = [&](const Buffer& from, const Buffer& to, GLuint scale) {
+        glProgramUniform1ui(program, 0, scale);
+        GLState().UseProgram(program);
+        GLState().BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, from.Name());
+        GLState().BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, to.Name());
+        glDispatchCompute((count + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    };
+
+    // correctness: a -> b, then d -> a overwrites what the first pass read (write-after-read),
+    // then a -> c reads that (read-after-write); one more barrier before the read back
+    Buffer& a = buffers[0];
+    Buffer& b = buffers[1];
+    Buffer& c = buffers[2];
+    Buffer& d = buffers[3];
+    scheduler.BeginFrame();
+    pass(a, b, 2);
+    pass(d, a, 5);
+    pass(a, c, 3);
+    scheduler.Consume({ { a.Name(), ResourceUsage::BufferUpdate, ResourceAccess::Read },
+        { b.Name(), ResourceUsage::BufferUpdate, ResourceAccess::Read },
+        { c.Name(), ResourceUsage::BufferUpdate, ResourceAccess::Read } });
+    scheduler.BeginFrame();
+    std::vector<GLuint> results[3] = { std::vector<GLuint>(count), std::vector<GLuint>(count), std::vector<GLuint>(count) };
+    const Buffer* readBack[3] = { &a, &b, &c };
+    for (int i = 0; i < 3; ++i)
+    {
+        GLState().BindBuffer(GL_COPY_READ_BUFFER, readBack[i]->Name());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, count * sizeof(GLuint), results[i].data());
+    }
+    size_t wrong = 0;
+    for (GLuint i = 0; i < count; ++i)
+    {
+        wrong += results[0][i] != 5 * i + 1;
+        wrong += results[1][i] != 2 * i + 1;
+        wrong += results[2][i] != 3 * (5 * i + 1) + 1;
+    }
+    bool passed = wrong == 0 && scheduler.BarriersLastFrame() == 3;
+    std::cout << "Compute scheduler: 3 dispatches, " << scheduler.BarriersLastFrame() << " barriers (expected 3), "
+        << wrong << " wrong values: " << (passed ? "PASS" : "FAIL") << std::endl;
+
+    // throughput: a ping-pong chain needs a barrier per dispatch, a fan-out from one source into
+    // eight targets one per eight dispatches (write-after-write)
+    GLuint query;
+    glGenQueries(1, &query);
+    const char* workloads[2] = { "dependent", "independent" };
+    const char* modes[2] = { "scheduled", "full barriers" };
+    for (int workload = 0; workload < 2; ++workload)
+    {
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            scheduler.BeginFrame();
+            glFinish();
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < dispatches; ++i)
+            {
+                const Buffer& from = workload == 0 ? (i & 1 ? c : b) : d;
+                const Buffer& to = workload == 0 ? (i & 1 ? b : c) : targets[i % 8];
+                if (mode == 0)
+                    pass(from, to, 1);
+                else
+                    fullBarrierPass(from, to, 1);
+            }
+            double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            glEndQuery(GL_TIME_ELAPSED);
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            scheduler.BeginFrame();
+            unsigned int barriers = mode == 1 ? (unsigned int)dispatches : scheduler.BarriersLastFrame();
+            std::cout << "Compute " << workloads[workload] << ", " << modes[mode] << ": " << dispatches << " dispatches of "
+                << count << " elements, " << barriers << " barriers, GPU " << nanoseconds * 1e-6 << " ms ("
+                << dispatches / (nanoseconds * 1e-9) << " dispatches/s, "
+                << 2.0 * count * sizeof(GLuint) * dispatches / (nanoseconds * 1e-9) / 1e9 << " GB/s), CPU " << cpuMs << " ms" << std::endl;
+        }
+    }
+    glDeleteQueries(1, &query);
+    std::cout << "Compute scheduler tracks " << scheduler.TrackedObjects() << " object(s) after the run" << std::endl;
+    GLState().UseProgram(0);
+    glDeleteProgram(program);
+}
+
+// --uniform-bench: UNIFORM_BENCH_DRAWS draws a frame, five uniforms each (10k per frame), set by
+// name with glGetUniformLocation + glUniform* and through ProgramReflection with hashed names
+// ------------------------------------------------------------------------------------------------
+void RunUniformBenchmark(int frames)
+{
+    const int UNIFORM_BENCH_DRAWS = 2000;
+    const char* vertexSource =
+        "#version 460 core\n"
+        "uniform mat4 model;\n"
+        "uniform vec4 offset;\n"
+        "uniform float scale;\n"
+        "void main() { gl_Position = model * (offset * scale); }\n";
+    const char* fragmentSource =
+        "#version 460 core\n"
+        "uniform vec4 tint;\n"
+        "uniform double exposure;\n"
+        "out vec4 FragColor;\n"
+        "void main() { FragColor = tint * float(exposure); }\n";
+    std::vector<GLuint> shaders = {
+        CompileShader(GL_VERTEX_SHADER, vertexSource, "uniform-bench"),
+        CompileShader(GL_FRAGMENT_SHADER, fragmentSource, "uniform-bench"),
+    };
+    GLuint program = LinkProgram(shaders, "uniform-bench", false);
+    for (GLuint shader : shaders)
+        glDeleteShader(shader);
+    Texture target;
+    Framebuffer framebuffer;
+    VertexArray vertexArray;
+    if (program == 0 || !target.Create2D(GL_RGBA8, 1, 1) || !framebuffer.Create() || !vertexArray.Create())
+    {
+        glDeleteProgram(program);
+        return;
+    }
+    framebuffer.AttachTexture(GL_COLOR_ATTACHMENT0, target);
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, framebuffer.Name());
+    GLState().Viewport(0, 0, 1, 1);
+    GLState().BindVertexArray(vertexArray.Name());
+    GLState().UseProgram(program);
+
+    ProgramReflection reflection;
+    reflection.Reflect(program);
+    const uint64_t names[5] = { "model"_hash, "offset"_hash, "scale"_hash, "tint"_hash, "exposure"_hash };
+    for (uint64_t name : names)
+    {
+        if (reflection.Find(name) < 0)
+        {
+            std::cout << "ERROR::UNIFORM_BENCH::UNIFORM_NOT_REFLECTED" << std::endl;
+            glDeleteProgram(program);
+            return;
+        }
+    }
+
+    float model[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+    float offset[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    float tint[4] = { 1.0f, 0.5f, 0.25f, 1.0f };
+    const char* modes[2] = { "by name", "reflection" };
+    double ms[2] = { 0.0, 0.0 };
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            for (int draw = 0; draw < UNIFORM_BENCH_DRAWS; ++draw)
+            {
+                model[12] = offset[0] = (float)draw / UNIFORM_BENCH_DRAWS;
+                float scale = 1.0f + (float)frame;
+                double exposure = 0.5 + draw * 1e-4;
+                if (mode == 0)
+                {
+                    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, model);
+                    glUniform4fv(glGetUniformLocation(program, "offset"), 1, offset);
+                    glUniform1f(glGetUniformLocation(program, "scale"), scale);
+                    glUniform4fv(glGetUniformLocation(program, "tint"), 1, tint);
+                    glUniform1d(glGetUniformLocation(program, "exposure"), exposure);
+                }
+                else
+                {
+                    reflection.Set("model"_hash, model);
+                    reflection.Set("offset"_hash, offset);
+                    reflection.Set("scale"_hash, scale);
+                    reflection.Set("tint"_hash, tint);
+                    reflection.Set("exposure"_hash, exposure);
+                    reflection.Apply();
+                }
+                glDrawArrays(GL_POINTS, 0, 1);
+            }
+        }
+        glFinish();
+        ms[mode] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        std::cout << "Uniforms " << modes[mode] << ": " << ms[mode] << " ms/frame for " << UNIFORM_BENCH_DRAWS * 5
+            << " uniforms, " << UNIFORM_BENCH_DRAWS * 5 / ms[mode] / 1000.0 << " M uniforms/s" << std::endl;
+    }
+    GLState().UseProgram(0);
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteProgram(program);
+}
+
+// --preprocess-bench: expands a generated corpus of N shaders, each pulling in a chain of
+// include files, and reports the preprocessor's throughput with a cold and a warm file cache
+// ------------------------------------------------------------------------------------------------
+void RunPreprocessBenchmark(int shaders)
+{
+    const std::string directory = "shader_cache/preprocess_bench";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory + "/include", error);
+    if (error)
+    {
+        std::cout << "ERROR::PREPROCESS_BENCH::CANNOT_CREATE_" << directory << std::endl;
+        return;
+    }
+
+    auto writeFile = [](const std::string& path, const std::string& text) {
+        std::ofstream(path, std::ios::binary) << text;
+    };
+
+    // headers: guarded, commented, with conditional blocks, each including the two before it
+    const int headers = std::max(8, shaders / 4);
+    size_t corpusBytes = 0;
+    for (int i = 0; i < headers; ++i)
+    {
+        std::string guard = "BENCH_HEADER_" + std::to_string(i);
+        std::string text = "#ifndef " + guard + "\n#define " + guard + "\n";
+        for (int include = std::max(0, i - 2); include < i; ++include)
+            text += "#include \"header_" + std::to_string(include) + ".glsl\"\n";
+        for (int function = 0; function < 16; ++function)
+        {
+            std::string name = "f" + std::to_string(i) + "_" + std::to_string(function);
+            text += "/* " + name + ": a block comment\n   spanning two lines */\n";
+            text += "#if QUALITY > " + std::to_string(function % 4) + "\n";
+            text += "vec4 " + name + "(vec4 v) { return v * " + std::to_string(function + 1) + ".0; } // high\n";
+            text += "#else\nvec4 " + name + "(vec4 v) { return v; }\n#endif\n";
+        }
+        text += "#endif\n";
+        corpusBytes += text.size();
+        writeFile(directory + "/include/header_" + std::to_string(i) + ".glsl", text);
+    }
+    std::vector<std::string> roots;
+    for (int i = 0; i < shaders; ++i)
+    {
+        // every other root has no #version, like stage snippets concatenated by the application
+        std::string text = (i & 1) ? "" : "#version 460 core\n";
+        for (int include = 0; include < 8; ++include)
+            text += "#include \"header_" + std::to_string((i * 7 + include * 3) % headers) + ".glsl\"\n";
+        text += "out vec4 color;\nvoid main()\n{\n    color = vec4(1.0);\n";
+        for (int line = 0; line < 64; ++line)
+        {
+            text += "#ifdef USE_FEATURE_" + std::to_string(line % 8) + "\n";
+            text += "    color = f" + std::to_string((i + line) % headers) + "_" + std::to_string(line % 16) + "(color);\n#endif\n";
+        }
+        text += "}\n";
+        corpusBytes += text.size();
+        roots.push_back(directory + "/root_" + std::to_string(i) + ".frag");
+        writeFile(roots.back(), text);
+    }
+
+    const std::vector<std::string> defines = { "QUALITY 2", "USE_FEATURE_1", "USE_FEATURE_4" };
+    ShaderPreprocessor preprocessor;
+    preprocessor.AddIncludePath(directory + "/include");
+    const char* names[2] = { "cold", "warm" };
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        size_t outputBytes = 0;
+        size_t files = 0;
+        int failures = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& root : roots)
+        {
+            PreprocessedSource result = preprocessor.Process(root, defines);
+            failures += result.ok ? 0 : 1;
+            outputBytes += result.code.size();
+            files += result.files.size();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Preprocess " << names[pass] << ": " << shaders << " shaders, " << files << " files, "
+            << outputBytes / (1024.0 * 1024.0) << " MB out in " << seconds * 1000.0 << " ms ("
+            << outputBytes / (1024.0 * 1024.0) / seconds << " MB/s, " << files / seconds << " files/s)";
+        if (failures > 0)
+            std::cout << ", " << failures << " failed";
+        std::cout << std::endl;
+    }
+    std::cout << "Preprocess corpus: " << headers << " headers and " << shaders << " shaders, "
+        << corpusBytes / 1024.0 << " KB on disk" << std::endl;
+    std::filesystem::remove_all(directory, error);
+}
+
+// builds and updates `count` buffers, textures and vertex arrays, once through DSA and once
+// through the bind-to-edit fallback, and reports CPU time, edits and binds for each
+// ---------------------------------------------------------------------------------------------
+void RunResourceBenchmark(int count, bool countCalls)
+{
+    const int passes = DirectStateAccessSupported() ? 2 : 1;
+    std::vector<unsigned char> data(256, 0xff);
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        UseDirectStateAccess(pass == 0 && passes == 2);
+        GLState().Invalidate();
+        GetResourceStats() = ResourceStats();
+        GLStateCache::BeginFrame();
+        unsigned long long driverCallsBefore = DriverCalls();
+
+        double start = glfwGetTime();
+        {
+            std::vector<Buffer> buffers(count);
+            std::vector<Texture> textures(count);
+            std::vector<VertexArray> vertexArrays(count);
+            for (int i = 0; i < count; ++i)
+            {
+                buffers[i].Create((GLsizeiptr)data.size(), nullptr, GL_DYNAMIC_STORAGE_BIT);
+                textures[i].Create2D(GL_RGBA8, 4, 4);
+                textures[i].SetParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                vertexArrays[i].Create();
+                vertexArrays[i].SetAttribute(0, 0, 4, GL_FLOAT, GL_FALSE, 0);
+                vertexArrays[i].SetVertexBuffer(0, buffers[i], 0, 16);
+            }
+            for (int i = 0; i < count; ++i)
+            {
+                buffers[i].SetData(0, (GLsizeiptr)data.size(), data.data());
+                textures[i].SetImage(0, 0, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+            }
+            glFinish();
+        }
+        double ms = (glfwGetTime() - start) * 1000.0;
+
+        GLStateCache::BeginFrame();
+        const ResourceStats& stats = GetResourceStats();
+        unsigned long long binds = GLStateCache::RequestsLastFrame() - GLStateCache::FilteredLastFrame();
+        std::cout << (UsingDirectStateAccess() ? "DSA" : "Bind-to-edit") << ": " << count << " resources of each kind in "
+            << ms << " ms, " << stats.edits << " edits, " << binds << " binds ("
+            << GLStateCache::FilteredLastFrame() << " skipped by the state cache)";
+        if (countCalls)
+            std::cout << ", " << DriverCalls() - driverCallsBefore << " state calls reached the driver";
+        std::cout << std::endl;
+    }
+    UseDirectStateAccess(true);
+    GLState().Invalidate();
+}
+
+// synthetic scene for --queue-bench: random programs, materials, vertex arrays and depths,
+// each draw a single (degenerate) triangle so the cost measured is submission, not shading
+// -----------------------------------------------------------------------------------------
+void RecordQueueBenchmark(RenderQueue& queue, int count, GLuint program, const std::vector<VertexArray>& vertexArrays)
+{
+    unsigned int seed = 12345;
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        DrawCommand command;
+        command.program = program;
+        command.vertexArray = vertexArrays[(seed >> 8) % vertexArrays.size()].Name();
+        command.material = (uint16_t)((seed >> 16) % 32);
+        command.indexType = 0;
+        command.count = 3;
+        RenderPass pass = (seed & 7) == 0 ? RenderPass::Transparent : RenderPass::Opaque;
+        queue.Submit(pass, (float)(seed & 0xFFFF) / 65535.0f, command);
+    }
+}
+
+// synthetic scene for --record-bench: objects are culled against a view frustum and recorded
+// with their view depth, on 1 to all hardware threads; GL is never called
+// ---------------------------------------------------------------------------------------------
+void RunRecordingBenchmark(int objects)
+{
+    struct SceneObject
+    {
+        float x, y, z, radius;
+        GLuint vertexArray;
+        uint16_t material;
+    };
+
+    std::vector<SceneObject> scene(objects);
+    unsigned int seed = 12345;
+    for (SceneObject& object : scene)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        object.x = (float)(seed % 2000) - 1000.0f;
+        object.y = (float)((seed >> 11) % 200) - 100.0f;
+        object.z = -(float)((seed >> 3) % 1000);
+        object.radius = 1.0f + (float)(seed % 7);
+        object.vertexArray = 1 + (seed >> 20) % 64;
+        object.material = (uint16_t)((seed >> 7) % 32);
+    }
+
+    // camera at the origin looking down -z, 90 degree field of view, far plane at 1000
+    const float farPlane = 1000.0f;
+    const float halfAngle = 0.70710678f;
+    ParallelRecorder::RecordFunction record = [&](CommandList& list, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const SceneObject& object = scene[i];
+            float depth = -object.z;
+            if (depth + object.radius < 0.1f || depth - object.radius > farPlane)
+                continue;
+            if ((std::fabs(object.x) - depth) * halfAngle > object.radius
+                || (std::fabs(object.y) - depth) * halfAngle > object.radius)
+                continue;
+
+            DrawCommand command;
+            command.program = 1;
+            command.vertexArray = object.vertexArray;
+            command.material = object.material;
+            command.count = 36;
+            list.Submit(RenderPass::Opaque, depth / farPlane, command);
+        }
+    };
+
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    double single = 0.0;
+    for (unsigned int threads = 1; threads <= hardwareThreads; ++threads)
+    {
+        ParallelRecorder recorder;
+        recorder.Start(threads - 1);
+        RenderQueue queue;
+        double best = 1e9;
+        for (int run = 0; run < 10; ++run)
+        {
+            queue.Clear();
+            double start = glfwGetTime();
+            recorder.Record(scene.size(), 1024, record);
+            recorder.MergeInto(queue);
+            best = std::min(best, glfwGetTime() - start);
+        }
+        if (threads == 1)
+            single = best;
+        std::cout << "Recording " << objects << " objects on " << threads << " thread(s): " << best * 1000.0
+            << " ms (" << single / best << "x), " << queue.Size() << " draws" << std::endl;
+    }
+}
+
+// synthetic scene for --gpu-scene: cubes scattered in front of the camera at the origin, the same
+// layout as --record-bench so part of them is culled
+// ------------------------------------------------------------------------------------------------
+void BuildGpuSceneBenchmark(GpuScene& scene, int objects)
+{
+    const float cube[] = {
+        -1, -1, -1,   1, -1, -1,   1,  1, -1,  -1,  1, -1,
+        -1, -1,  1,   1, -1,  1,   1,  1,  1,  -1,  1,  1,
+    };
+    const GLuint cubeIndices[] = {
+        0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+        3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+    };
+    int mesh = scene.AddMesh(cube, 8, cubeIndices, 36);
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < objects; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float position[3] = {
+            (float)(seed % 2000) - 1000.0f,
+            (float)((seed >> 11) % 200) - 100.0f,
+            -(float)((seed >> 3) % 1000),
+        };
+        scene.AddObject(mesh, position, 0.5f + (float)(seed % 3));
+    }
+}
+
+// column-major perspective projection with a 90 degree vertical field of view
+// ---------------------------------------------------------------------------
+void PerspectiveMatrix(float aspect, float nearPlane, float farPlane, float matrix[16])
+{
+    std::fill(matrix, matrix + 16, 0.0f);
+    matrix[0] = 1.0f / aspect;
+    matrix[5] = 1.0f;
+    matrix[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+    matrix[11] = -1.0f;
+    matrix[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+}
+
+// aspect ratio of the window's framebuffer as DisplayConfig last saw it
+// ---------------------------------------------------------------------
+float WindowAspect(GLFWwindow* window)
+{
+    const DisplayState& state = display.State(window);
+    return state.framebufferHeight > 0 ? (float)state.framebufferWidth / state.framebufferHeight : 1.0f;
+}
+
+// --permutations scene: a unit cube with normals, tangents and UVs (VertexFormat's fp32 layout),
+// bone weights splitting it into a bottom and a top half, four instance offsets, a bumpy normal
+// map and a 1x1 shadow map that leaves everything lit
+// --------------------------------------------------------------------------------------------
+void CreatePermutationScene(PermutationScene& scene)
+{
+    std::vector<MeshVertex> cube;
+    std::vector<GLuint> elements;
+    std::vector<float> weights;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (float side = -1.0f; side <= 1.0f; side += 2.0f)
+        {
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            GLuint first = (GLuint)cube.size();
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                float cu = (corner & 1) ? 1.0f : -1.0f;
+                float cv = (corner & 2) ? 1.0f : -1.0f;
+                MeshVertex vertex = {};
+                vertex.position[axis] = 0.5f * side;
+                vertex.position[u] = 0.5f * cu;
+                vertex.position[v] = 0.5f * cv;
+                vertex.normal[axis] = side;
+                vertex.tangent[u] = 1.0f;
+                vertex.tangent[3] = side;
+                vertex.uv[0] = cu * 0.5f + 0.5f;
+                vertex.uv[1] = cv * 0.5f + 0.5f;
+                cube.push_back(vertex);
+                bool top = vertex.position[1] > 0.0f;
+                weights.insert(weights.end(), { top ? 0.0f : 1.0f, top ? 1.0f : 0.0f, 0.0f, 0.0f });
+            }
+            const GLuint quad[6] = { 0, 1, 3, 0, 3, 2 };
+            for (GLuint index : quad)
+                elements.push_back(first + index);
+        }
+    }
+    PackedMesh mesh = PackVertices(cube.data(), (GLsizei)cube.size(), VertexFormat::Float32);
+    const float instances[16] = {
+        -0.3f, 0.0f, -0.3f, 0.4f,   0.3f, 0.0f, -0.3f, 0.4f,
+        -0.3f, 0.0f,  0.3f, 0.4f,   0.3f, 0.0f,  0.3f, 0.4f,
+    };
+    // bone 1 widens the top half, bones 2 and 3 are unused
+    float bones[4][16] = {};
+    for (int bone = 0; bone < 4; ++bone)
+        bones[bone][0] = bones[bone][5] = bones[bone][10] = bones[bone][15] = 1.0f;
+    bones[1][0] = bones[1][10] = 1.4f;
+
+    scene.vertices.Create((GLsizeiptr)mesh.vertices.size(), mesh.vertices.data(), 0);
+    scene.indices.Create((GLsizeiptr)(elements.size() * sizeof(GLuint)), elements.data(), 0);
+    scene.instances.Create(sizeof(instances), instances, 0);
+    scene.boneWeights.Create((GLsizeiptr)(weights.size() * sizeof(float)), weights.data(), 0);
+    scene.bones.Create(sizeof(bones), bones, 0);
+
+    unsigned char normals[8 * 8 * 4];
+    for (int i = 0; i < 8 * 8; ++i)
+    {
+        bool bump = ((i % 8) + (i / 8)) % 2 == 0;
+        normals[i * 4 + 0] = bump ? 160 : 96;
+        normals[i * 4 + 1] = 128;
+        normals[i * 4 + 2] = 240;
+        normals[i * 4 + 3] = 255;
+    }
+    scene.normalMap.Create2D(GL_RGBA8, 8, 8);
+    scene.normalMap.SetImage(0, 0, 0, 8, 8, GL_RGBA, GL_UNSIGNED_BYTE, normals);
+    scene.normalMap.SetParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    const float depth = 1.0f;
+    scene.shadowMap.Create2D(GL_DEPTH_COMPONENT24, 1, 1);
+    scene.shadowMap.SetImage(0, 0, 0, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+    scene.shadowMap.SetParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    scene.shadowMap.SetParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    scene.shadowMap.SetParameter(GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    scene.shadowMap.SetParameter(GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    scene.vertexArray.Create();
+    SetupVertexFormat(scene.vertexArray, 0, scene.vertices, mesh);
+    scene.vertexArray.SetElementBuffer(scene.indices);
+    scene.vertexArray.SetVertexBuffer(1, scene.instances, 0, 4 * sizeof(float), 1);
+    scene.vertexArray.SetAttribute(4, 1, 4, GL_FLOAT, GL_FALSE, 0);
+    scene.vertexArray.SetVertexBuffer(2, scene.boneWeights, 0, 4 * sizeof(float));
+    scene.vertexArray.SetAttribute(5, 2, 4, GL_FLOAT, GL_FALSE, 0);
+}
+
+// one cube per feature combination in a 4x4 grid; every Get may compile (a stall) on a cold run
+// -----------------------------------------------------------------------------------------------
+void DrawPermutationScene(PermutationScene& scene, ShaderPermutations& permutations, float aspect)
+{
+    float viewProjection[16];
+    PerspectiveMatrix(aspect, 0.1f, 100.0f, viewProjection);
+    // orthographic light looking down -z over the grid, inside the 1x1 shadow map everywhere
+    const float lightViewProjection[16] = { 0.1f, 0, 0, 0,  0, 0.1f, 0, 0,  0, 0, -0.05f, 0,  0, 0, 0, 1 };
+
+    GLStateCache& state = GLState();
+    state.BindVertexArray(scene.vertexArray.Name());
+    state.BindTextureUnit(0, scene.normalMap.Name());
+    state.BindTextureUnit(1, scene.shadowMap.Name());
+    state.BindBufferBase(GL_UNIFORM_BUFFER, 2, scene.bones.Name()); // Bones in uber.vert
+    for (uint32_t bits = 0; bits < (1u << SHADER_FEATURE_COUNT); ++bits)
+    {
+        PermutationKey key(bits);
+        GLuint program = permutations.Get(key);
+        if (program == 0)
+            continue;
+        if (program == permutations.Fallback())
+        {
+            // failed variant: the fallback keeps its own identity transform
+            state.UseProgram(program);
+            glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr, 1);
+            continue;
+        }
+        const float placement[4] = { ((float)(bits & 3) - 1.5f) * 2.5f, ((float)(bits >> 2) - 1.5f) * 2.5f, -10.0f, 1.5f };
+        glProgramUniformMatrix4fv(program, 0, 1, GL_FALSE, viewProjection);
+        glProgramUniform4fv(program, 1, 1, placement);
+        if (key.Has(ShaderFeature::Shadow))
+            glProgramUniformMatrix4fv(program, 2, 1, GL_FALSE, lightViewProjection);
+        state.UseProgram(program);
+        glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr, key.Has(ShaderFeature::Instancing) ? 4 : 1);
+    }
+}
+
+// material matrix stages; the salt keeps the driver's own shader cache out of the build times
+// ------------------------------------------------------------------------------------------------
+std::string MaterialMatrixVertexSource(int geometry, const std::string& salt)
+{
+    return "#version 460 core\n"
+        "#define MATRIX_SALT " + salt + "\n"
+        "out gl_PerVertex { vec4 gl_Position; };\n"
+        "layout(location = 0) in vec2 aPos;\n"
+        "layout(location = 0) uniform vec4 placement; // xy centre, zw half size\n"
+        "layout(location = 0) out vec2 uv;\n"
+        "void main()\n"
+        "{\n"
+        "    float angle = " + std::to_string(geometry * 0.15f) + ";\n"
+        "    vec2 p = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * aPos;\n"
+        "    p *= 1.0 + " + std::to_string((geometry % 5) * 0.05f) + " * sin(p.yx * " + std::to_string(geometry + 1) + ".0);\n"
+        "    uv = aPos * 0.5 + 0.5;\n"
+        "    gl_Position = vec4(placement.xy + p * placement.zw, 0.0, 1.0);\n"
+        "}\n";
+}
+
+std::string MaterialMatrixFragmentSource(int material, const std::string& salt)
+{
+    return "#version 460 core\n"
+        "#define MATRIX_SALT " + salt + "\n"
+        "layout(location = 0) in vec2 uv;\n"
+        "layout(location = 0) out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "    vec3 base = vec3(" + std::to_string((material % 4) / 3.0f) + ", " + std::to_string((material / 4) / 4.0f)
+            + ", " + std::to_string(1.0f - material / (float)MATRIX_SIZE) + ");\n"
+        "    float pattern = 0.5 + 0.5 * sin((uv.x + uv.y * " + std::to_string(material % 3) + ".0) * "
+            + std::to_string(6 + material * 2) + ".0);\n"
+        "    FragColor = vec4(base * (0.4 + 0.6 * pattern), 1.0);\n"
+        "}\n";
+}
+
+// builds every stage or program plus, separable, every pipeline of the current context, so the
+// build time is the whole startup cost
+// ------------------------------------------------------------------------------------------------
+bool CreateMaterialMatrix(MaterialMatrix& matrix, bool separable)
+{
+    const float quad[8] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+    if (!matrix.vertices.Create(sizeof(quad), quad, 0) || !matrix.vertexArray.Create())
+        return false;
+    matrix.vertexArray.SetVertexBuffer(0, matrix.vertices, 0, 2 * sizeof(float));
+    matrix.vertexArray.SetAttribute(0, 0, 2, GL_FLOAT, GL_FALSE, 0);
+    matrix.separable = separable;
+
+    GLint availableBefore = 0;
+    if (GLAD_GL_NVX_gpu_memory_info)
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableBefore);
+    std::string salt = std::to_string((unsigned long long)(glfwGetTime() * 1e6) ^ (unsigned long long)std::time(nullptr));
+
+    auto start = std::chrono::steady_clock::now();
+    if (separable)
+    {
+        matrix.pipelines = std::make_unique<ProgramPipelines>();
+        for (int i = 0; i < MATRIX_SIZE; ++i)
+        {
+            matrix.vertexStages.push_back(matrix.pipelines->Stage(GL_VERTEX_SHADER, MaterialMatrixVertexSource(i, salt), "matrix geometry"));
+            matrix.fragmentStages.push_back(matrix.pipelines->Stage(GL_FRAGMENT_SHADER, MaterialMatrixFragmentSource(i, salt), "matrix material"));
+        }
+        for (GLuint vertexStage : matrix.vertexStages)
+        {
+            for (GLuint fragmentStage : matrix.fragmentStages)
+            {
+                if (vertexStage != 0 && fragmentStage != 0)
+                    matrix.pipelines->Pipeline(vertexStage, fragmentStage);
+            }
+        }
+    }
+    else
+    {
+        for (int geometry = 0; geometry < MATRIX_SIZE; ++geometry)
+        {
+            for (int material = 0; material < MATRIX_SIZE; ++material)
+            {
+                std::vector<GLuint> shaders = {
+                    CompileShader(GL_VERTEX_SHADER, MaterialMatrixVertexSource(geometry, salt), "matrix geometry"),
+                    CompileShader(GL_FRAGMENT_SHADER, MaterialMatrixFragmentSource(material, salt), "matrix material"),
+                };
+                matrix.programs.push_back(LinkProgram(shaders, "matrix", false));
+                for (GLuint shader : shaders)
+                    glDeleteShader(shader);
+            }
+        }
+    }
+    glFinish();
+    matrix.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const std::vector<GLuint>& built = separable ? matrix.vertexStages : matrix.programs;
+    std::vector<GLuint> all(built);
+    all.insert(all.end(), matrix.fragmentStages.begin(), matrix.fragmentStages.end());
+    for (GLuint program : all)
+    {
+        GLint length = 0;
+        if (program != 0)
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        matrix.programBytes += length;
+    }
+    if (GLAD_GL_NVX_gpu_memory_info)
+    {
+        GLint availableAfter = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableAfter);
+        matrix.videoMemoryKilobytes = availableBefore - availableAfter;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void DrawMaterialMatrix(MaterialMatrix& matrix, GLStateCache& state)
+{
+    state.BindVertexArray(matrix.vertexArray.Name());
+    // a program made current with glUseProgram takes precedence over the bound pipeline
+    if (matrix.separable)
+        state.UseProgram(0);
+    const float cell = 2.0f / MATRIX_SIZE;
+    for (int geometry = 0; geometry < MATRIX_SIZE; ++geometry)
+    {
+        for (int material = 0; material < MATRIX_SIZE; ++material)
+        {
+            const float placement[4] = { -1.0f + (material + 0.5f) * cell, -1.0f + (geometry + 0.5f) * cell, cell * 0.4f, cell * 0.4f };
+            if (matrix.separable)
+            {
+                GLuint vertexStage = matrix.vertexStages[geometry];
+                GLuint fragmentStage = matrix.fragmentStages[material];
+                if (vertexStage == 0 || fragmentStage == 0)
+                    continue;
+                glProgramUniform4fv(vertexStage, 0, 1, placement);
+                state.BindProgramPipeline(matrix.pipelines->Pipeline(vertexStage, fragmentStage));
+            }
+            else
+            {
+                GLuint program = matrix.programs[geometry * MATRIX_SIZE + material];
+                if (program == 0)
+                    continue;
+                glProgramUniform4fv(program, 0, 1, placement);
+                state.UseProgram(program);
+            }
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    }
+}
+
+// needs the context that created the matrix current
+// ------------------------------------------------------------------------------------------------
+void ReleaseMaterialMatrix(MaterialMatrix& matrix)
+{
+    // the cache would otherwise filter binds of recycled names
+    GLState().UseProgram(0);
+    GLState().BindProgramPipeline(0);
+    // deletes this context's pipelines and the stage programs
+    matrix.pipelines.reset();
+    for (GLuint program : matrix.programs)
+        glDeleteProgram(program);
+    matrix = MaterialMatrix();
+}
+
+// ------------------------------------------------------------------------------------------------
+void ReportMaterialMatrix(const MaterialMatrix& matrix)
+{
+    std::cout << "Material matrix " << (matrix.separable ? "separable" : "monolithic") << ": " << MATRIX_SIZE << "x" << MATRIX_SIZE
+        << " combinations, ";
+    if (matrix.separable)
+        std::cout << matrix.pipelines->StageCompiles() << " stage programs and " << matrix.pipelines->PipelineCount() << " pipelines";
+    else
+        std::cout << matrix.programs.size() << " programs";
+    std::cout << " built in " << matrix.buildMilliseconds << " ms, " << matrix.programBytes / 1024.0 << " KB of program binaries";
+    if (matrix.videoMemoryKilobytes >= 0)
+        std::cout << ", " << matrix.videoMemoryKilobytes / 1024.0 << " MB of video memory";
+    std::cout << std::endl;
+}
+
+// --pipeline-bench: builds the material matrix monolithic and separable on the current context
+// and draws it `frames` times into an offscreen target; reports startup, memory and frame cost
+// ------------------------------------------------------------------------------------------------
+void RunPipelineBenchmark(int frames)
+{
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_separate_shader_objects)
+    {
+        std::cout << "ERROR::PIPELINE_BENCH::SEPARATE_SHADER_OBJECTS_NOT_SUPPORTED" << std::endl;
+        return;
+    }
+    Texture target;
+    Framebuffer framebuffer;
+    if (!target.Create2D(GL_RGBA8, 512, 512) || !framebuffer.Create())
+        return;
+    framebuffer.AttachTexture(GL_COLOR_ATTACHMENT0, target);
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        MaterialMatrix matrix;
+        if (!CreateMaterialMatrix(matrix, pass == 1))
+            continue;
+        ReportMaterialMatrix(matrix);
+
+        GLState().BindFramebuffer(GL_FRAMEBUFFER, framebuffer.Name());
+        GLState().Viewport(0, 0, 512, 512);
+        DrawMaterialMatrix(matrix, GLState()); // first use patches shader variants in some drivers
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+            DrawMaterialMatrix(matrix, GLState());
+        glFinish();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Material matrix " << (matrix.separable ? "separable" : "monolithic") << ": " << ms / frames
+            << " ms per " << MATRIX_SIZE * MATRIX_SIZE << "-draw frame" << std::endl;
+        ReleaseMaterialMatrix(matrix);
+    }
+    GLState().UseProgram(0);
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// --forest meshes: a box trunk and a pyramid crown sharing one vertex and one index buffer;
+// the vertex array also fetches the render queue's per-instance data from the frame ring
+// --------------------------------------------------------------------------------------------
+void CreateForestMeshes(Buffer& vertices, Buffer& indices, VertexArray& vertexArray, const DynamicBufferRing& instances)
+{
+    const float positions[] = {
+        // trunk, 0.2 x 1 x 0.2
+        -0.1f, 0.0f, -0.1f,   0.1f, 0.0f, -0.1f,   0.1f, 1.0f, -0.1f,  -0.1f, 1.0f, -0.1f,
+        -0.1f, 0.0f,  0.1f,   0.1f, 0.0f,  0.1f,   0.1f, 1.0f,  0.1f,  -0.1f, 1.0f,  0.1f,
+        // crown
+        -0.6f, 1.0f, -0.6f,   0.6f, 1.0f, -0.6f,   0.6f, 1.0f,  0.6f,  -0.6f, 1.0f,  0.6f,
+         0.0f, 2.5f,  0.0f,
+    };
+    const GLuint elements[] = {
+        0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+        3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+        0, 1, 2, 0, 2, 3,   0, 4, 1,   1, 4, 2,   2, 4, 3,   3, 4, 0,
+    };
+    vertices.Create(sizeof(positions), positions, 0);
+    indices.Create(sizeof(elements), elements, 0);
+    vertexArray.Create();
+    vertexArray.SetVertexBuffer(0, vertices, 0, 3 * sizeof(float));
+    vertexArray.SetAttribute(0, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    vertexArray.SetElementBuffer(indices);
+    RenderQueue::SetupInstanceAttribute(vertexArray, instances);
+}
+
+// synthetic scene for --forest: every tree submits its trunk and its crown as separate instanced
+// draws, scattered over a plane in front of the camera
+// ---------------------------------------------------------------------------------------------
+void RecordForestBenchmark(RenderQueue& queue, int trees, GLuint program, const VertexArray& vertexArray)
+{
+    const uint16_t bark = 0;
+    const uint16_t leaves = 1;
+    const float farPlane = 1000.0f;
+    unsigned int seed = 12345;
+    for (int i = 0; i < trees; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float x = (float)(seed % 2000) - 1000.0f;
+        float z = -1.0f - (float)((seed >> 11) % 999);
+        float scale = 2.0f + (float)((seed >> 3) % 5);
+
+        DrawCommand part;
+        part.program = program;
+        part.vertexArray = vertexArray.Name();
+        part.instanced = true;
+        part.instance[0] = x;
+        part.instance[1] = -10.0f;
+        part.instance[2] = z;
+        part.instance[3] = scale;
+
+        part.material = bark;
+        part.count = 36;
+        part.first = 0;
+        part.baseVertex = 0;
+        queue.Submit(RenderPass::Opaque, -z / farPlane, part);
+
+        part.material = leaves;
+        part.count = 18;
+        part.first = 36 * sizeof(GLuint);
+        part.baseVertex = 8;
+        queue.Submit(RenderPass::Opaque, -z / farPlane, part);
+    }
+}
+
+// --vertex-format-bench: random vertices packed both ways. The decoded compressed vertices are
+// checked against the quantisation bounds (half a step of 16-bit unorm over the bounding box,
+// 10-bit snorm, half float), then every vertex is drawn into a 1x1 target so the time is
+// dominated by vertex fetch
+// --------------------------------------------------------------------------------------------
+void RunVertexFormatBenchmark(int vertices)
+{
+    int count = std::max(3, vertices / 3 * 3);
+    std::vector<MeshVertex> mesh(count);
+    unsigned int seed = 12345;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (float)(seed >> 8) / 16777215.0f;
+    };
+    for (MeshVertex& vertex : mesh)
+    {
+        float normal[3] = { random() * 2.0f - 1.0f, random() * 2.0f - 1.0f, random() * 2.0f - 1.0f };
+        float length = std::max(std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]), 1e-3f);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            vertex.position[axis] = random() * 200.0f - 100.0f;
+            vertex.normal[axis] = normal[axis] / length;
+            // orthogonal to the normal is not needed for the bounds
+            vertex.tangent[axis] = normal[(axis + 1) % 3] / length;
+        }
+        vertex.tangent[3] = random() < 0.5f ? -1.0f : 1.0f;
+        vertex.uv[0] = random() * 4.0f;
+        vertex.uv[1] = random() * 4.0f;
+    }
+
+    PackedMesh meshes[2] = {
+        PackVertices(mesh.data(), count, VertexFormat::Float32),
+        PackVertices(mesh.data(), count, VertexFormat::Compressed),
+    };
+
+    // error bounds
+    const PackedMesh& packed = meshes[1];
+    float positionError = 0.0f;
+    float positionBound = 0.0f;
+    float normalError = 0.0f;
+    float uvError = 0.0f;
+    bool withinBounds = true;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        // half a quantisation step, plus fp32 rounding of the decode
+        float bound = 0.5f * packed.boundsExtent[axis] / 65535.0f
+            + 4.0f * 1.2e-7f * (std::fabs(packed.boundsMin[axis]) + packed.boundsExtent[axis]);
+        positionBound = std::max(positionBound, bound);
+        for (int i = 0; i < count; ++i)
+        {
+            float error = std::fabs(UnpackVertex(packed, i).position[axis] - mesh[i].position[axis]);
+            positionError = std::max(positionError, error);
+            withinBounds = withinBounds && error <= bound;
+        }
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        MeshVertex decoded = UnpackVertex(packed, i);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            normalError = std::max(normalError, std::fabs(decoded.normal[axis] - mesh[i].normal[axis]));
+            normalError = std::max(normalError, std::fabs(decoded.tangent[axis] - mesh[i].tangent[axis]));
+        }
+        withinBounds = withinBounds && decoded.tangent[3] == mesh[i].tangent[3];
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            float error = std::fabs(decoded.uv[axis] - mesh[i].uv[axis]);
+            uvError = std::max(uvError, error / std::max(std::fabs(mesh[i].uv[axis]), 6.1e-5f));
+        }
+    }
+    const float normalBound = 0.5f / 511.0f + 1e-6f;
+    const float uvBound = 1.0f / 2048.0f; // relative, half a unit in the last place of a half
+    withinBounds = withinBounds && normalError <= normalBound && uvError <= uvBound;
+    std::cout << "Vertex format error: position " << positionError << " (bound " << positionBound << "), normal/tangent "
+        << normalError << " (bound " << normalBound << "), uv " << uvError << " relative (bound " << uvBound << "): "
+        << (withinBounds ? "PASS" : "FAIL") << std::endl;
+
+    // size and fetch time
+    ProgramSource source = LoadProgramSource("packed_mesh", "shaders/packed_mesh.vert", "shaders/basic.frag");
+    source.defines.push_back("FETCH_BENCHMARK");
+    GLuint program = BuildProgram(source);
+    Texture target;
+    Framebuffer framebuffer;
+    if (program == 0 || !target.Create2D(GL_RGBA8, 1, 1) || !framebuffer.Create())
+    {
+        glDeleteProgram(program);
+        return;
+    }
+    framebuffer.AttachTexture(GL_COLOR_ATTACHMENT0, target);
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, framebuffer.Name());
+    GLState().Viewport(0, 0, 1, 1);
+    GLState().UseProgram(program);
+    const float identity[16] = { 0.01f, 0, 0, 0,  0, 0.01f, 0, 0,  0, 0, 0.01f, 0,  0, 0, 0, 1 };
+    glProgramUniformMatrix4fv(program, 0, 1, GL_FALSE, identity);
+
+    GLuint query;
+    glGenQueries(1, &query);
+    const int draws = 20;
+    const char* names[2] = { "fp32", "compressed" };
+    for (const PackedMesh& format : meshes)
+    {
+        Buffer buffer;
+        VertexArray vertexArray;
+        buffer.Create((GLsizeiptr)format.vertices.size(), format.vertices.data(), 0);
+        vertexArray.Create();
+        SetupVertexFormat(vertexArray, 0, buffer, format);
+        vertexArray.Bind();
+        glProgramUniform3fv(program, 1, 1, format.boundsMin);
+        glProgramUniform3fv(program, 2, 1, format.boundsExtent);
+
+        glDrawArrays(GL_TRIANGLES, 0, count); // warm up
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (int i = 0; i < draws; ++i)
+            glDrawArrays(GL_TRIANGLES, 0, count);
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+
+        double bytes = (double)format.vertices.size();
+        double seconds = nanoseconds * 1e-9 / draws;
+        std::cout << "Vertex format " << names[&format - meshes] << ": " << format.stride << " bytes/vertex, "
+            << bytes / (1024.0 * 1024.0) << " MB, " << seconds * 1000.0 << " ms/draw, "
+            << (seconds > 0.0 ? bytes / seconds / 1e9 : 0.0) << " GB/s fetched" << std::endl;
+    }
+    glDeleteQueries(1, &query);
+    glDeleteProgram(program);
+    GLState().UseProgram(0);
+    GLState().BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,14 @@
+#version 460 core
+// GLSL port of VertexShader.hlsl
+layout (location = 0) in vec4 aPos;
+
+// redeclared so the stage also works as a separable program
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    gl_Position = aPos;
+}
@@ -0,0 +1,8 @@
+#version 460 core
+layout (location = 0) out vec4 FragColor;
+
+void main()
+{
+    // loud on purpose, a placeholder should not pass for the real thing
+    FragColor = vec4(1.0, 0.0, 1.0, 1.0);
+}
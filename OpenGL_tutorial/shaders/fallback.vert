@@ -0,0 +1,12 @@
+#version 460 core
+// Stands in for programs that are still compiling or failed to build: positions only, transformed
+// by the viewProjection uniform at location 0 like instanced.vert and packed_mesh.vert. main sets
+// it to identity after building; no initializer, the SPIR-V path has no uniform initializers.
+layout (location = 0) in vec4 aPos;
+
+layout (location = 0) uniform mat4 viewProjection;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(aPos.xyz, 1.0);
+}
@@ -0,0 +1,32 @@
+#version 450 core
+// Vertex stage for GpuScene: the object index arrives as an instanced attribute offset by the
+// draw command's baseInstance, so it works with or without ARB_shader_draw_parameters.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in uint aObject;
+
+struct Object
+{
+    vec4 positionScale;
+    uint mesh;
+};
+
+layout (std140, binding = 1) uniform Camera
+{
+    mat4 viewProjection;
+    vec4 frustum[6];
+    uint objectCount;
+    uint compact;
+};
+
+layout (std430, binding = 0) readonly buffer Objects { Object objects[]; };
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    vec4 positionScale = objects[aObject].positionScale;
+    gl_Position = viewProjection * vec4(aPos * positionScale.w + positionScale.xyz, 1.0);
+}
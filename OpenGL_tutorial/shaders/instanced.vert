@@ -0,0 +1,17 @@
+#version 450 core
+// Vertex stage for render queue draws merged by RenderQueue::Batch: each instance carries
+// a world position and a uniform scale.
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in vec4 aInstance; // RenderQueue::INSTANCE_ATTRIBUTE
+
+layout (location = 0) uniform mat4 viewProjection;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    gl_Position = viewProjection * vec4(aPos * aInstance.w + aInstance.xyz, 1.0);
+}
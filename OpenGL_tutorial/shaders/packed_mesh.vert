@@ -0,0 +1,36 @@
+#version 450 core
+// Vertex stage for meshes packed by PackVertices (VertexFormat.h). The fetch already decodes
+// normals, tangents and UVs; positions of compressed meshes arrive as [0, 1] inside the mesh's
+// bounding box. Float32 meshes use boundsMin 0 and boundsExtent 1.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec4 aTangent;
+layout (location = 3) in vec2 aTexCoord;
+
+layout (location = 0) uniform mat4 viewProjection;
+layout (location = 1) uniform vec3 boundsMin;
+layout (location = 2) uniform vec3 boundsExtent;
+
+layout (location = 0) out VS_OUT
+{
+    vec3 normal;
+    vec4 tangent;
+    vec2 texCoord;
+} vs_out;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    vs_out.normal = aNormal;
+    vs_out.tangent = aTangent;
+    vs_out.texCoord = aTexCoord;
+    gl_Position = viewProjection * vec4(boundsMin + aPos * boundsExtent, 1.0);
+#ifdef FETCH_BENCHMARK
+    // nothing reads the outputs in the benchmark; keep every attribute live
+    gl_Position.xyz += (aNormal + aTangent.xyz * aTangent.w + vec3(aTexCoord, 0.0)) * 1e-6;
+#endif
+}
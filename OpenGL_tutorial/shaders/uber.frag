@@ -0,0 +1,39 @@
+#version 450 core
+layout (location = 0) in VS_OUT
+{
+    vec3 normal;
+    vec4 tangent;
+    vec2 texCoord;
+#ifdef USE_SHADOW
+    vec4 lightPosition;
+#endif
+} fs_in;
+
+layout (location = 0) out vec4 FragColor;
+
+#ifdef USE_NORMAL_MAP
+layout (binding = 0) uniform sampler2D normalMap;
+#endif
+#ifdef USE_SHADOW
+layout (binding = 1) uniform sampler2DShadow shadowMap;
+#endif
+
+const vec3 lightDirection = vec3(0.267, 0.891, 0.445);
+
+void main()
+{
+    vec3 normal = normalize(fs_in.normal);
+#ifdef USE_NORMAL_MAP
+    vec3 tangent = normalize(fs_in.tangent.xyz - normal * dot(normal, fs_in.tangent.xyz));
+    vec3 bitangent = cross(normal, tangent) * fs_in.tangent.w;
+    vec3 mapped = texture(normalMap, fs_in.texCoord).xyz * 2.0 - 1.0;
+    normal = normalize(mat3(tangent, bitangent, normal) * mapped);
+#endif
+
+    float light = max(dot(normal, lightDirection), 0.0);
+#ifdef USE_SHADOW
+    vec3 shadowCoord = fs_in.lightPosition.xyz / fs_in.lightPosition.w * 0.5 + 0.5;
+    light *= texture(shadowMap, shadowCoord);
+#endif
+    FragColor = vec4(vec3(1.0, 0.5, 0.2) * (0.2 + 0.8 * light), 1.0);
+}
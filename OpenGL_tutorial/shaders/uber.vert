@@ -0,0 +1,62 @@
+#version 450 core
+// Uber shader for ShaderPermutations: every optional feature sits behind the USE_* define
+// PermutationKey::Defines emits for it, so each combination compiles to a variant of its own.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec4 aTangent;
+layout (location = 3) in vec2 aTexCoord;
+#ifdef USE_INSTANCING
+layout (location = 4) in vec4 aInstance; // offset and scale relative to `placement`
+#endif
+#ifdef USE_SKINNING
+layout (location = 5) in vec4 aBoneWeights; // one weight per palette entry
+
+layout (std140, binding = 2) uniform Bones
+{
+    mat4 bones[4];
+};
+#endif
+
+layout (location = 0) uniform mat4 viewProjection;
+layout (location = 1) uniform vec4 placement; // world offset, uniform scale
+#ifdef USE_SHADOW
+layout (location = 2) uniform mat4 lightViewProjection;
+#endif
+
+layout (location = 0) out VS_OUT
+{
+    vec3 normal;
+    vec4 tangent;
+    vec2 texCoord;
+#ifdef USE_SHADOW
+    vec4 lightPosition;
+#endif
+} vs_out;
+
+void main()
+{
+    vec4 position = vec4(aPos, 1.0);
+    vec3 normal = aNormal;
+    vec3 tangent = aTangent.xyz;
+#ifdef USE_SKINNING
+    mat4 skin = bones[0] * aBoneWeights.x + bones[1] * aBoneWeights.y
+        + bones[2] * aBoneWeights.z + bones[3] * aBoneWeights.w;
+    position = skin * position;
+    normal = mat3(skin) * normal;
+    tangent = mat3(skin) * tangent;
+#endif
+
+    vec4 offsetScale = placement;
+#ifdef USE_INSTANCING
+    offsetScale = vec4(placement.xyz + aInstance.xyz, placement.w * aInstance.w);
+#endif
+    vec3 world = position.xyz * offsetScale.w + offsetScale.xyz;
+
+    vs_out.normal = normal;
+    vs_out.tangent = vec4(tangent, aTangent.w);
+    vs_out.texCoord = aTexCoord;
+#ifdef USE_SHADOW
+    vs_out.lightPosition = lightViewProjection * vec4(world, 1.0);
+#endif
+    gl_Position = viewProjection * vec4(world, 1.0);
+}
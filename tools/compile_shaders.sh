@@ -0,0 +1,22 @@
+#!/bin/sh
+# Offline shader compilation to SPIR-V for the glShaderBinary/glSpecializeShader path.
+# VertexShader.hlsl is cross-compiled from HLSL; the GLSL shaders in OpenGL_tutorial/shaders are
+# compiled for the OpenGL SPIR-V environment. Requires glslangValidator on PATH.
+#
+# usage: tools/compile_shaders.sh [output directory]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SRC="$ROOT/OpenGL_tutorial"
+OUT="${1:-$SRC/shaders/spirv}"
+mkdir -p "$OUT"
+
+# HLSL: POSITION has no explicit location, let glslang assign location 0; -G like the GLSL
+# stages below, the module is consumed by OpenGL (ARB_gl_spirv), not Vulkan
+glslangValidator -G -D -S vert -e main --auto-map-locations \
+    "$SRC/VertexShader.hlsl" -o "$OUT/VertexShader.vert.spv"
+
+for shader in "$SRC"/shaders/*.vert "$SRC"/shaders/*.frag "$SRC"/shaders/*.comp; do
+    [ -e "$shader" ] || continue
+    glslangValidator -G "$shader" -o "$OUT/$(basename "$shader").spv"
+done
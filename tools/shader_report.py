@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Per-shader cost report from spirv-dis disassembly.
+
+For every module it prints the number of instructions inside functions and an estimate of
+register pressure: the largest number of SSA values that are live at the same time, computed
+over each function's instructions in order (control flow is ignored, so loops are approximate).
+
+With --baseline the report is compared against a previous run and the script exits non-zero
+when a shader grew by more than --tolerance percent, so CI catches cost regressions.
+"""
+import argparse
+import os
+import re
+import sys
+
+ID = re.compile(r'%[\w.]+')
+NOT_COUNTED = {'OpFunction', 'OpFunctionEnd', 'OpFunctionParameter', 'OpLabel', 'OpLine', 'OpNoLine'}
+
+
+def analyse(path):
+    instructions = 0
+    pressure = 0
+    in_function = False
+    body = []
+
+    for line in open(path):
+        line = line.split(';')[0].strip()
+        if not line:
+            continue
+        result = None
+        if re.match(r'%[\w.]+\s*=', line):
+            result, line = [part.strip() for part in line.split('=', 1)]
+        opcode = line.split()[0]
+
+        if opcode == 'OpFunction':
+            in_function = True
+            body = []
+            continue
+        if opcode == 'OpFunctionEnd':
+            pressure = max(pressure, live_peak(body))
+            in_function = False
+            continue
+        if not in_function:
+            continue
+        if opcode not in NOT_COUNTED:
+            instructions += 1
+        body.append((result, ID.findall(line[len(opcode):])))
+
+    return instructions, pressure
+
+
+def live_peak(body):
+    defined = {}
+    last_use = {}
+    for index, (result, uses) in enumerate(body):
+        if result:
+            defined[result] = index
+        for used in uses:
+            if used in defined:
+                last_use[used] = index
+
+    events = []
+    for value, start in defined.items():
+        events.append((start, 1))
+        events.append((last_use.get(value, start) + 1, -1))
+    live = peak = 0
+    for _, delta in sorted(events, key=lambda event: (event[0], event[1])):
+        live += delta
+        peak = max(peak, live)
+    return peak
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('disassembly', nargs='+')
+    parser.add_argument('--baseline', help='previous report to compare against')
+    parser.add_argument('--write-baseline', help='write this run as the new baseline')
+    parser.add_argument('--tolerance', type=float, default=5.0, help='allowed growth in percent')
+    args = parser.parse_args()
+
+    report = {}
+    for path in args.disassembly:
+        name = os.path.basename(path).replace('.txt', '')
+        report[name] = analyse(path)
+
+    print('%-32s %12s %10s' % ('shader', 'instructions', 'pressure'))
+    for name, (instructions, pressure) in sorted(report.items()):
+        print('%-32s %12d %10d' % (name, instructions, pressure))
+
+    if args.write_baseline:
+        with open(args.write_baseline, 'w') as baseline:
+            for name, (instructions, pressure) in sorted(report.items()):
+                baseline.write('%s %d %d\n' % (name, instructions, pressure))
+
+    failed = False
+    if args.baseline and os.path.exists(args.baseline):
+        for line in open(args.baseline):
+            name, instructions, pressure = line.split()
+            if name not in report:
+                continue
+            for label, old, new in (('instructions', int(instructions), report[name][0]),
+                                    ('pressure', int(pressure), report[name][1])):
+                if new > old * (1.0 + args.tolerance / 100.0):
+                    print('REGRESSION: %s %s %d -> %d' % (name, label, old, new))
+                    failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
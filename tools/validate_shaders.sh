@@ -0,0 +1,36 @@
+#!/bin/sh
+# Offline shader validation and optimisation, no GPU needed (CI).
+# Every shader, VertexShader.hlsl included, is compiled to SPIR-V by tools/compile_shaders.sh,
+# checked with spirv-val, optimised with spirv-opt -O into shaders/spirv/opt and summarised by
+# tools/shader_report.py (instruction count and register-pressure estimate per shader).
+# The --spirv path loads the optimised modules when they exist (SpirvModulePath), so the report
+# describes the code the driver actually receives.
+# The modules are OpenGL modules (glslangValidator -G), validated and optimised as such.
+# When tools/shader_baseline.txt exists the run fails if a shader got more expensive;
+# pass --update-baseline to accept the current numbers.
+# Requires glslangValidator, spirv-val, spirv-opt, spirv-dis and python3 on PATH.
+#
+# usage: tools/validate_shaders.sh [--update-baseline]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+TARGET_ENV=opengl4.5
+OUT="$ROOT/OpenGL_tutorial/shaders/spirv"
+BASELINE="$ROOT/tools/shader_baseline.txt"
+
+"$ROOT/tools/compile_shaders.sh" "$OUT"
+mkdir -p "$OUT/opt"
+
+for module in "$OUT"/*.spv; do
+    name=$(basename "$module")
+    spirv-val --target-env $TARGET_ENV "$module"
+    spirv-opt --target-env=$TARGET_ENV -O "$module" -o "$OUT/opt/$name"
+    spirv-val --target-env $TARGET_ENV "$OUT/opt/$name"
+    spirv-dis --no-header "$OUT/opt/$name" -o "$OUT/opt/$name.txt"
+done
+
+if [ "$1" = "--update-baseline" ]; then
+    python3 "$ROOT/tools/shader_report.py" "$OUT"/opt/*.txt --write-baseline "$BASELINE"
+else
+    python3 "$ROOT/tools/shader_report.py" "$OUT"/opt/*.txt --baseline "$BASELINE"
+fi